@@ -59,6 +59,14 @@ void GPRSbeeClass::init(Stream &stream, int ctsPin, int powerPin)
   _ftpMaxLength = 0;
   _transMode = false;
   _echoOff = false;
+  _sleepMode = false;
+  _sleeping = false;
+  _ltsMode = false;
+  _networkTimeFresh = false;
+  _httpActionTime = 0;
+  _httpActionEnd = 0;
+  _httpDataLen = 0;
+  _httpReadStopped = false;
 #if defined(__AVR_ATmega1284P__)
   _onoffMethod = false;
 #endif
@@ -71,6 +79,13 @@ void GPRSbeeClass::init(Stream &stream, int ctsPin, int powerPin)
 
 bool GPRSbeeClass::on()
 {
+  if (_sleeping && isOn()) {
+    if (wakeUp()) {
+      return true;
+    }
+    // It does not answer anymore. Start all over with a full power cycle.
+    off();
+  }
 #if defined(__AVR_ATmega1284P__)
   if (_onoffMethod) {
     onPowerSwitch();
@@ -98,9 +113,68 @@ bool GPRSbeeClass::off()
   offToggle();
 end:
   _echoOff = false;
+  _sleeping = false;
+  _networkTimeFresh = false;
   return !isOn();
 }
 
+/*
+ * \brief Put the SIM900 in slow clock (sleep) mode
+ *
+ * The SIM900 stays registered to the network, so the next session
+ * does not have to go through a full boot and network search.
+ *
+ * On the GPRSbee the DTR pin of the bee socket is used to switch the
+ * SIM900 on and off, so it cannot be used to wake it up. That's why
+ * we use AT+CSCLK=2: the SIM900 goes to sleep by itself when the
+ * serial line is idle, and it wakes up when it receives characters.
+ */
+bool GPRSbeeClass::sleep()
+{
+  if (!sendCommandWaitForOK_P(PSTR("AT+CSCLK=2"))) {
+    return false;
+  }
+  _sleeping = true;
+  // The next session needs a new network time update
+  _networkTimeFresh = false;
+  return true;
+}
+
+/*
+ * \brief Wake up the SIM900 from slow clock mode
+ *
+ * The first characters sent to a sleeping SIM900 are lost. isAlive()
+ * sends "AT" a few times, which gives it the time to wake up.
+ */
+bool GPRSbeeClass::wakeUp()
+{
+  diagPrintLn(F("wakeUp"));
+  if (!isAlive()) {
+    return false;
+  }
+  if (!sendCommandWaitForOK_P(PSTR("AT+CSCLK=0"))) {
+    return false;
+  }
+  _sleeping = false;
+  return true;
+}
+
+/*
+ * \brief End of a session, switch off the SIM900 or let it sleep
+ *
+ * It only goes to sleep if that was requested with setSleepMode(). That
+ * is also done after a failure, so that a retry does not have to go
+ * through a full boot and network search. If the SIM900 does not answer
+ * anymore it is switched off, a fresh start is the best way to recover.
+ */
+void GPRSbeeClass::offOrSleep()
+{
+  if (_sleepMode && sleep()) {
+    return;
+  }
+  off();
+}
+
 /*
  * Switch GPRSbee on via the toggle method
  *
@@ -206,11 +280,40 @@ void GPRSbeeClass::switchEchoOff()
   }
 }
 
+/*
+ * \brief Discard the input from SIM900
+ *
+ * The lines are still checked for unsolicited messages.
+ */
 void GPRSbeeClass::flushInput()
 {
   int c;
+  _SIM900_bufcnt = 0;
   while ((c = _myStream->read()) >= 0) {
     diagPrint((char)c);
+    if (c == '\r' || c == '\n') {
+      _SIM900_buffer[_SIM900_bufcnt] = 0;
+      checkURC();
+      _SIM900_bufcnt = 0;
+    } else if (_SIM900_bufcnt < SIM900_BUFLEN) {
+      _SIM900_buffer[_SIM900_bufcnt++] = c;
+    }
+  }
+}
+
+/*
+ * \brief Look at a line for the unsolicited messages we care about
+ *
+ * With AT+CLTS=1 the SIM900 reports a network time update (NITZ) with
+ * *PSUTTZ and +CTZV. Only after such an update AT+CCLK? gives the network
+ * time. Otherwise it is the free running clock of the SIM900, e.g. after
+ * it was sleeping.
+ */
+void GPRSbeeClass::checkURC()
+{
+  if (strncmp_P(_SIM900_buffer, PSTR("*PSUTTZ:"), 8) == 0 ||
+      strncmp_P(_SIM900_buffer, PSTR("+CTZV:"), 6) == 0) {
+    _networkTimeFresh = true;
   }
 }
 
@@ -261,6 +364,7 @@ int GPRSbeeClass::readLine(uint32_t ts_max)
 
 ok:
   _SIM900_buffer[_SIM900_bufcnt] = 0;     // Terminate with NUL byte
+  checkURC();
   //diagPrint(F(" ")); diagPrintLn(_SIM900_buffer);
   return _SIM900_bufcnt;
 
@@ -631,6 +735,65 @@ bool GPRSbeeClass::waitForCREG()
   return false;
 }
 
+/*
+ * \brief Make sure the SIM900 is registered and attached to GPRS
+ *
+ * The full sequence (signal quality, CREG and CGATT) can take several
+ * seconds. It always starts with AT+CGATT?, because the SIM900 is often
+ * still attached, e.g. a retry right after a failure or a session after
+ * sleep. Then that single query is enough.
+ */
+bool GPRSbeeClass::attachGPRS()
+{
+  // Suppress echoing
+  switchEchoOff();
+
+  if (isGPRSAttached()) {
+    return true;
+  }
+
+  if (_ltsMode) {
+    // Ask for the network time (NITZ) as early as possible, it is
+    // sent to us when the SIM900 registers to the network.
+    enableLTS();
+  }
+
+  // Wait for signal quality
+  if (!waitForSignalQuality()) {
+    return false;
+  }
+
+  // Wait for CREG
+  if (!waitForCREG()) {
+    return false;
+  }
+
+  // Attach to GPRS service
+  // We need a longer timeout than the normal waitForOK
+  if (!sendCommandWaitForOK_P(PSTR("AT+CGATT=1"), 30000)) {
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * \brief Ask the SIM900 if it is attached to GPRS
+ *
+ *   >> AT+CGATT?
+ *   << +CGATT: 1
+ *   <<
+ *   << OK
+ */
+bool GPRSbeeClass::isGPRSAttached()
+{
+  int value;
+  if (!getIntValue("AT+CGATT?", "+CGATT:", &value, millis() + 4000)) {
+    return false;
+  }
+  return value == 1;
+}
+
 /*
 Secondly, you should use the command group AT+CSTT, AT+CIICR and AT+CIFSR to start
 the task and activate the wireless connection. Lastly, you can establish TCP connection between
@@ -670,22 +833,7 @@ bool GPRSbeeClass::openTCP(const char *apn, const char *apnuser, const char *apn
     goto ending;
   }
 
-  // Suppress echoing
-  switchEchoOff();
-
-  // Wait for signal quality
-  if (!waitForSignalQuality()) {
-    goto cmd_error;
-  }
-
-  // Wait for CREG
-  if (!waitForCREG()) {
-    goto cmd_error;
-  }
-
-  // Attach to GPRS service
-  // We need a longer timeout than the normal waitForOK
-  if (!sendCommandWaitForOK_P(PSTR("AT+CGATT=1"), 30000)) {
+  if (!attachGPRS()) {
     goto cmd_error;
   }
 
@@ -760,7 +908,7 @@ bool GPRSbeeClass::openTCP(const char *apn, const char *apnuser, const char *apn
 
 cmd_error:
   diagPrintLn(F("openTCP failed!"));
-  off();
+  offOrSleep();
 
 ending:
   return retval;
@@ -783,7 +931,7 @@ void GPRSbeeClass::closeTCP()
     diagPrintLn(F("closeTCP failed!"));
   }
 
-  off();
+  offOrSleep();
 }
 
 bool GPRSbeeClass::isTCPConnected()
@@ -914,26 +1062,11 @@ bool GPRSbeeClass::openFTP(const char *apn, const char *apnuser, const char *apn
     goto ending;
   }
 
-  // Suppress echoing
-  switchEchoOff();
-
-  // Wait for signal quality
-  if (!waitForSignalQuality()) {
-    goto cmd_error;
-  }
-
-  // Wait for CREG
-  if (!waitForCREG()) {
-    goto cmd_error;
-  }
-
-  // Attach to GPRS service
-  // We need a longer timeout than the normal waitForOK
-  if (!sendCommandWaitForOK_P(PSTR("AT+CGATT=1"), 30000)) {
+  if (!attachGPRS()) {
     goto cmd_error;
   }
 
-  if (!setBearerParms(apn, apnuser, apnpwd)) {
+  if (!openBearer(apn, apnuser, apnpwd)) {
     goto cmd_error;
   }
 
@@ -970,7 +1103,7 @@ bool GPRSbeeClass::openFTP(const char *apn, const char *apnuser, const char *apn
 
 cmd_error:
   diagPrintLn(F("openFTP failed!"));
-  off();
+  offOrSleep();
 
 ending:
   return false;
@@ -978,7 +1111,7 @@ ending:
 
 bool GPRSbeeClass::closeFTP()
 {
-  off();            // Ignore errors
+  offOrSleep();         // Ignore errors
   return true;
 }
 
@@ -1244,7 +1377,7 @@ cmd_error:
   diagPrintLn(F("sendSMS failed!"));
 
 ending:
-  off();
+  offOrSleep();
   return retval;
 }
 
@@ -1367,35 +1500,57 @@ ending:
   return retval;
 }
 
-bool GPRSbeeClass::doHTTPprolog(const char *apn)
-{
-  return doHTTPprolog(apn, 0, 0);
-}
-
-bool GPRSbeeClass::doHTTPprolog(const char *apn, const char *apnuser, const char *apnpwd)
+/*
+ * The middle part of the whole HTTP GET, with the reply going to a sink
+ *
+ * HTTPPARA with the URL
+ * HTTPACTION
+ * HTTPREAD, in ranges of the size of the buffer
+ */
+bool GPRSbeeClass::doHTTPGETmiddle(const char *url, HTTPREADsink sink, uint8_t *buffer, size_t bufsize)
 {
   bool retval = false;
 
-  // Suppress echoing
-  switchEchoOff();
+  // set http param URL value
+  sendCommandProlog();
+  sendCommandAdd_P(PSTR("AT+HTTPPARA=\"URL\",\""));
+  sendCommandAdd(url);
+  sendCommandAdd('"');
+  sendCommandEpilog();
+  if (!waitForOK()) {
+    goto ending;
+  }
 
-  // Wait for signal quality
-  if (!waitForSignalQuality()) {
+  if (!doHTTPACTION(0)) {
     goto ending;
   }
 
-  // Wait for CREG
-  if (!waitForCREG()) {
+  // Read all data
+  if (!doHTTPREAD(sink, buffer, bufsize)) {
     goto ending;
   }
 
-  // Attach to GPRS service
-  // We need a longer timeout than the normal waitForOK
-  if (!sendCommandWaitForOK_P(PSTR("AT+CGATT=1"), 30000)) {
+  // All is well if we get here.
+  retval = true;
+
+ending:
+  return retval;
+}
+
+bool GPRSbeeClass::doHTTPprolog(const char *apn)
+{
+  return doHTTPprolog(apn, 0, 0);
+}
+
+bool GPRSbeeClass::doHTTPprolog(const char *apn, const char *apnuser, const char *apnpwd)
+{
+  bool retval = false;
+
+  if (!attachGPRS()) {
     goto ending;
   }
 
-  if (!setBearerParms(apn, apnuser, apnpwd)) {
+  if (!openBearer(apn, apnuser, apnpwd)) {
     goto ending;
   }
 
@@ -1423,13 +1578,36 @@ void GPRSbeeClass::doHTTPepilog()
   }
 }
 
+/*
+ * \brief Wait for the +HTTPREAD reply and get the data length from it
+ *
+ * Expect
+ *   +HTTPREAD:<date_len>
+ */
+bool GPRSbeeClass::waitForHTTPREAD(uint32_t *len)
+{
+  uint32_t ts_max = millis() + 8000;
+  if (!waitForMessage_P(PSTR("+HTTPREAD:"), ts_max)) {
+    // Hmm. Why didn't we get this?
+    return false;
+  }
+  const char *ptr = _SIM900_buffer + 10;
+  char *bufend;
+  *len = strtoul(ptr, &bufend, 0);
+  if (bufend == ptr) {
+    // Invalid number
+    return false;
+  }
+  return true;
+}
+
 /*
  * \brief Read the data from a GET or POST
  */
 bool GPRSbeeClass::doHTTPREAD(char *buffer, size_t len)
 {
   uint32_t ts_max;
-  size_t getLength = 0;
+  uint32_t getLength = 0;
   int i;
   bool retval = false;
 
@@ -1438,17 +1616,7 @@ bool GPRSbeeClass::doHTTPREAD(char *buffer, size_t len)
   //   <data>
   //   OK
   sendCommand_P(PSTR("AT+HTTPREAD"));
-  ts_max = millis() + 8000;
-  if (waitForMessage_P(PSTR("+HTTPREAD:"), ts_max)) {
-    const char *ptr = _SIM900_buffer + 10;
-    char *bufend;
-    getLength = strtoul(ptr, &bufend, 0);
-    if (bufend == ptr) {
-      // Invalid number
-      goto ending;
-    }
-  } else {
-    // Hmm. Why didn't we get this?
+  if (!waitForHTTPREAD(&getLength)) {
     goto ending;
   }
   // Read the data
@@ -1472,9 +1640,89 @@ ending:
   return retval;
 }
 
+/*
+ * \brief Read all the data from a GET or POST and pass it on to a sink
+ *
+ * The data is read in ranges of the size of the buffer. The sink gets
+ * each range when it is completely read, so nothing is in flight and the
+ * sink can take its time (e.g. write to dataflash).
+ *
+ * If the sink stops the reading, it is not an error. This returns true
+ * and isHTTPREADstopped() tells that the rest was skipped.
+ */
+bool GPRSbeeClass::doHTTPREAD(HTTPREADsink sink, uint8_t *buffer, size_t bufsize)
+{
+  uint32_t start = 0;
+  _httpReadStopped = false;
+  if (bufsize == 0) {
+    // Nothing would ever be read
+    return false;
+  }
+  while (start < _httpDataLen) {
+    uint32_t len = _httpDataLen - start;
+    if (len > bufsize) {
+      len = bufsize;
+    }
+    if (!doHTTPREAD(start, len, buffer)) {
+      return false;
+    }
+    if (!(*sink)(buffer, len)) {
+      // The sink does not want any more. Skip the rest.
+      _httpReadStopped = true;
+      break;
+    }
+    start += len;
+  }
+  return true;
+}
+
+/*
+ * \brief Read a range of the data from a GET or POST
+ *
+ * The buffer must be big enough for the whole range.
+ */
+bool GPRSbeeClass::doHTTPREAD(uint32_t start, uint32_t len, uint8_t *buffer)
+{
+  uint32_t ts_max;
+  uint32_t getLength = 0;
+  char num[12];
+  bool retval = false;
+
+  // Expect
+  //   +HTTPREAD:<date_len>
+  //   <data>
+  //   OK
+  sendCommandProlog();
+  sendCommandAdd_P(PSTR("AT+HTTPREAD="));
+  ultoa(start, num, 10);
+  sendCommandAdd(num);
+  sendCommandAdd(',');
+  ultoa(len, num, 10);
+  sendCommandAdd(num);
+  sendCommandEpilog();
+  if (!waitForHTTPREAD(&getLength)) {
+    goto ending;
+  }
+  // Read the data, at most len bytes are stored
+  ts_max = millis() + 4000;
+  if (readBytes(getLength, buffer, len, ts_max) == 0 && getLength == len) {
+    retval = true;
+  } else {
+    // We didn't get the bytes that we expected
+    // Still wait for OK
+  }
+  if (!waitForOK()) {
+    // This is an error, but we can still return success.
+  }
+
+ending:
+  return retval;
+}
+
 bool GPRSbeeClass::doHTTPACTION(char num)
 {
   uint32_t ts_max;
+  uint32_t start;
   bool retval = false;
 
   // set http action type 0 = GET, 1 = POST, 2 = HEAD
@@ -1482,6 +1730,7 @@ bool GPRSbeeClass::doHTTPACTION(char num)
   sendCommandAdd_P(PSTR("AT+HTTPACTION="));
   sendCommandAdd((int)num);
   sendCommandEpilog();
+  start = millis();
   if (!waitForOK()) {
     goto ending;
   }
@@ -1491,14 +1740,22 @@ bool GPRSbeeClass::doHTTPACTION(char num)
   // <DataLen> ??
   ts_max = millis() + 20000;
   if (waitForMessage_P(PSTR("+HTTPACTION:"), ts_max)) {
+    // Remember how long the request took, it can be used to
+    // correct a timestamp that was sent by the server.
+    _httpActionEnd = millis();
+    _httpActionTime = _httpActionEnd - start;
     // The 14 is the length of "+HTTPACTION:1,", i.e. WITH the digit and the comma
     const char *ptr = _SIM900_buffer + 14;
     char *bufend;
-    uint8_t replycode = strtoul(ptr, &bufend, 0);
+    uint16_t replycode = strtoul(ptr, &bufend, 0);
     if (bufend == ptr) {
       // Invalid number
       goto ending;
     }
+    _httpDataLen = 0;
+    if (*bufend == ',') {
+      _httpDataLen = strtoul(bufend + 1, NULL, 0);
+    }
     if (replycode == 200) {
       retval = true;
     } else {
@@ -1540,9 +1797,11 @@ bool GPRSbeeClass::doHTTPPOST(const char *apn, const char *apnuser, const char *
 
 cmd_error:
   diagPrintLn(F("doHTTPGET failed!"));
+  // Don't leave the HTTP service behind for the next session
+  doHTTPepilog();
 
 ending:
-  off();
+  offOrSleep();
   return retval;
 }
 
@@ -1576,9 +1835,11 @@ bool GPRSbeeClass::doHTTPPOSTWithReply(const char *apn, const char *apnuser, con
 
 cmd_error:
   diagPrintLn(F("doHTTPGET failed!"));
+  // Don't leave the HTTP service behind for the next session
+  doHTTPepilog();
 
 ending:
-  off();
+  offOrSleep();
   return retval;
 }
 
@@ -1615,12 +1876,85 @@ bool GPRSbeeClass::doHTTPGET(const char *apn, const char *apnuser, const char *a
 
 cmd_error:
   diagPrintLn(F("doHTTPGET failed!"));
+  // Don't leave the HTTP service behind for the next session
+  doHTTPepilog();
 
 ending:
-  off();
+  offOrSleep();
+  return retval;
+}
+
+bool GPRSbeeClass::doHTTPGET(const char *apn, const char *url, HTTPREADsink sink, uint8_t *buffer, size_t bufsize)
+{
+  bool retval = false;
+
+  if (!on()) {
+    goto ending;
+  }
+
+  if (!doHTTPprolog(apn)) {
+    goto cmd_error;
+  }
+
+  if (!doHTTPGETmiddle(url, sink, buffer, bufsize)) {
+    goto cmd_error;
+  }
+
+  retval = true;
+  doHTTPepilog();
+  goto ending;
+
+cmd_error:
+  diagPrintLn(F("doHTTPGET failed!"));
+  // Don't leave the HTTP service behind for the next session
+  doHTTPepilog();
+
+ending:
+  offOrSleep();
   return retval;
 }
 
+/*
+ * \brief Make sure bearer 1 is open
+ *
+ * The bearer is first queried (AT+SAPBR=2,1), it is often still open.
+ * That is a lot cheaper than setting it up again.
+ */
+bool GPRSbeeClass::openBearer(const char *apn, const char *user, const char *pwd)
+{
+  if (isBearerOpen()) {
+    return true;
+  }
+  return setBearerParms(apn, user, pwd);
+}
+
+/*
+ * \brief Query bearer 1
+ *
+ *   >> AT+SAPBR=2,1
+ *   << +SAPBR: 1,1,"10.172.34.218"
+ *   <<
+ *   << OK
+ *
+ * The second number is the status, 1 means "connected".
+ */
+bool GPRSbeeClass::isBearerOpen()
+{
+  int value = 0;
+  sendCommand_P(PSTR("AT+SAPBR=2,1"));
+  if (waitForMessage_P(PSTR("+SAPBR:"), millis() + 4000)) {
+    const char *ptr = strchr(_SIM900_buffer, ',');
+    if (ptr) {
+      ++ptr;
+      value = strtoul(ptr, NULL, 0);
+    }
+  }
+  if (!waitForOK()) {
+    return false;
+  }
+  return value == 1;
+}
+
 bool GPRSbeeClass::setBearerParms(const char *apn, const char *user, const char *pwd)
 {
   char cmd[64];
@@ -1700,6 +2034,13 @@ bool GPRSbeeClass::getCIMI(char *buffer, size_t buflen)
   return getStrValue("AT+CIMI", buffer, buflen, ts_max);
 }
 
+bool GPRSbeeClass::getCCID(char *buffer, size_t buflen)
+{
+  switchEchoOff();
+  uint32_t ts_max = millis() + 2000;
+  return getStrValue("AT+CCID", buffer, buflen, ts_max);
+}
+
 bool GPRSbeeClass::getCLIP(char *buffer, size_t buflen)
 {
   switchEchoOff();
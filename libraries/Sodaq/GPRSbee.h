@@ -28,12 +28,23 @@
 // diagnostic
 #define ENABLE_GPRSBEE_DIAG     1
 
+/*
+ * A sink receives the data of HTTPREAD, one range at a time. The size of
+ * a range is the size of the buffer given to doHTTPGET. It returns false
+ * to stop reading, see isHTTPREADstopped().
+ */
+typedef bool (*HTTPREADsink)(const uint8_t *data, size_t len);
+
 class GPRSbeeClass
 {
 public:
   void init(Stream &stream, int ctsPin, int powerPin);
   bool on();
   bool off();
+  bool sleep();
+  bool wakeUp();
+  bool isSleeping() const { return _sleeping; }
+  void setSleepMode(bool x) { _sleepMode = x; }
 #if defined(__AVR_ATmega1284P__)
   void setPowerSwitchedOnOff(bool x) { _onoffMethod = x; }
 #endif
@@ -41,6 +52,12 @@ public:
   void setDiag(Stream *stream) { _diagStream = stream; }
 
   void setMinSignalQuality(int q) { _minSignalQuality = q; }
+  void setLTSMode(bool x) { _ltsMode = x; }
+  // Was there a network time update (NITZ) since the SIM900 was switched on or woke up?
+  bool isNetworkTimeFresh() const { return _networkTimeFresh; }
+
+  uint16_t getHTTPACTIONTime() const { return _httpActionTime; }
+  uint32_t getHTTPACTIONEnd() const { return _httpActionEnd; }
 
   bool doHTTPPOST(const char *apn, const char *url, const char *postdata, size_t pdlen);
   bool doHTTPPOST(const char *apn, const String & url, const char *postdata, size_t pdlen);
@@ -59,8 +76,14 @@ public:
   bool doHTTPGET(const char *apn, const char *apnuser, const char *apnpwd,
       const char *url, char *buffer, size_t len);
   bool doHTTPGETmiddle(const char *url, char *buffer, size_t len);
+  bool doHTTPGET(const char *apn, const char *url, HTTPREADsink sink, uint8_t *buffer, size_t bufsize);
+  bool doHTTPGETmiddle(const char *url, HTTPREADsink sink, uint8_t *buffer, size_t bufsize);
 
   bool doHTTPREAD(char *buffer, size_t len);
+  bool doHTTPREAD(HTTPREADsink sink, uint8_t *buffer, size_t bufsize);
+  bool doHTTPREAD(uint32_t start, uint32_t len, uint8_t *buffer);
+  uint32_t getHTTPDataLength() const { return _httpDataLen; }
+  bool isHTTPREADstopped() const { return _httpReadStopped; }
   bool doHTTPACTION(char num);
 
   bool doHTTPprolog(const char *apn);
@@ -90,6 +113,7 @@ public:
   bool getIMEI(char *buffer, size_t buflen);
   bool getGCAP(char *buffer, size_t buflen);
   bool getCIMI(char *buffer, size_t buflen);
+  bool getCCID(char *buffer, size_t buflen);
   bool getCLIP(char *buffer, size_t buflen);
   bool getCLIR(char *buffer, size_t buflen);
   bool getCOLP(char *buffer, size_t buflen);
@@ -106,11 +130,13 @@ private:
   void offToggle();
   void onPowerSwitch();
   void offPowerSwitch();
+  void offOrSleep();
   bool isOn();
   void toggle();
   bool isAlive();
   void switchEchoOff();
   void flushInput();
+  void checkURC();
   int readLine(uint32_t ts_max);
   int readBytes(size_t len, uint8_t *buffer, size_t buflen, uint32_t ts_max);
   bool waitForOK(uint16_t timeout=4000);
@@ -118,6 +144,7 @@ private:
   bool waitForMessage_P(const char *msg, uint32_t ts_max);
   int waitForMessages(const char *msgs[], size_t nrMsgs, uint32_t ts_max);
   bool waitForPrompt(const char *prompt, uint32_t ts_max);
+  bool waitForHTTPREAD(uint32_t *len);
 
   void sendCommandProlog();
   void sendCommandAdd(char c);
@@ -137,6 +164,10 @@ private:
   bool getStrValue(const char *cmd, char * str, size_t size, uint32_t ts_max);
   bool waitForSignalQuality();
   bool waitForCREG();
+  bool attachGPRS();
+  bool isGPRSAttached();
+  bool openBearer(const char *apn, const char *user, const char *pwd);
+  bool isBearerOpen();
   bool setBearerParms(const char *apn, const char *user, const char *pwd);
 
   // Small utility to see if we timed out
@@ -156,6 +187,14 @@ private:
   size_t _ftpMaxLength;
   bool _transMode;
   bool _echoOff;
+  bool _sleepMode;
+  bool _sleeping;
+  bool _ltsMode;
+  bool _networkTimeFresh;
+  uint16_t _httpActionTime;
+  uint32_t _httpActionEnd;
+  uint32_t _httpDataLen;
+  bool _httpReadStopped;
 #if defined(__AVR_ATmega1284P__)
   bool _onoffMethod;
 #endif
@@ -51,42 +51,191 @@ bool RTCEvent::update(uint32_t now)
       // In case this wasn't initialized properly
       _lastEventTime = now;
     } else {
-      while ((int32_t)(now - (_lastEventTime + _period)) >= 0) {
-        // Skip all the events that are in the past
+      uint32_t late = now - (_lastEventTime + _period);
+      if (late > 0) {
+        if (_nrLate < 0xFFFF) {
+          ++_nrLate;
+        }
+        if (late > _maxLate) {
+          _maxLate = late > 0xFFFF ? 0xFFFF : late;
+        }
+      }
+      if (_eventType == RTCEvent_Every) {
         _lastEventTime += _period;
+        while ((int32_t)(now - (_lastEventTime + _period)) >= 0) {
+          // Skip all the events that are in the past
+          _lastEventTime += _period;
+          if (_nrSkipped < 0xFFFF) {
+            ++_nrSkipped;
+          }
+        }
       }
     }
-    switch (_eventType) {
-    case RTCEvent_Every:
-      (*_callback)(now);
-      break;
-    default:
-      break;
+
+    // The callback may cancel this event, or even create a new one
+    // in this slot. So first finish our own administration.
+    void (*callback)(uint32_t now) = 0;
+    void (*contextCallback)(uint32_t now, void *context) = 0;
+    void *context = _context;
+    bool hasContext = _hasContext;
+    if (hasContext) {
+      contextCallback = _contextCallback;
+    } else {
+      callback = _callback;
     }
-    if (_repeatCount > 0 && ++_count >= _repeatCount) {
+    if (_eventType == RTCEvent_At ||
+        (_repeatCount > 0 && ++_count >= _repeatCount)) {
       // Done. Free the event.
       _eventType = RTCEvent_None;
     }
+    if (hasContext) {
+      (*contextCallback)(now, context);
+    } else {
+      (*callback)(now);
+    }
     doneEvent = true;
   }
   return doneEvent;
 }
 
-int8_t RTCTimer::every(uint32_t period, void (*callback)(uint32_t now),
+/*
+ * Add an event that is executed every period seconds
+ *
+ * If repeatCount is positive the event is removed after that many times.
+ * The return value is the handle of the event, or -1 if there is no free
+ * slot.
+ */
+RTCEventHandle RTCTimer::every(uint32_t period, void (*callback)(uint32_t now),
+    int repeatCount)
+{
+  return addEvent(RTCEvent::RTCEvent_Every, period, _now ? _now() : 0,
+      callback, repeatCount);
+}
+
+RTCEventHandle RTCTimer::every(uint32_t period, void (*callback)(uint32_t now, void *context),
+    void *context, int repeatCount)
+{
+  return addEvent(RTCEvent::RTCEvent_Every, period, _now ? _now() : 0,
+      callback, context, repeatCount);
+}
+
+/*
+ * Add an event that is executed once, at timestamp ts
+ *
+ * If there already is such a one-shot event, with the same callback and
+ * context, no new event is added. Instead the existing event is moved to
+ * ts if that is earlier, and its handle is returned.
+ */
+RTCEventHandle RTCTimer::at(uint32_t ts, void (*callback)(uint32_t now))
+{
+  return addEvent(RTCEvent::RTCEvent_At, 0, ts, callback, 1);
+}
+
+RTCEventHandle RTCTimer::at(uint32_t ts, void (*callback)(uint32_t now, void *context),
+    void *context)
+{
+  return addEvent(RTCEvent::RTCEvent_At, 0, ts, callback, context, 1);
+}
+
+RTCEventHandle RTCTimer::addEvent(enum RTCEvent::RTCEventType eventType, uint32_t period,
+    uint32_t ts, void (*callback)(uint32_t now), int repeatCount)
+{
+  RTCEvent event;
+  event._callback = callback;
+  event._context = 0;
+  event._hasContext = false;
+  return addEvent(eventType, period, ts, event, repeatCount);
+}
+
+RTCEventHandle RTCTimer::addEvent(enum RTCEvent::RTCEventType eventType, uint32_t period,
+    uint32_t ts, void (*callback)(uint32_t now, void *context), void *context,
     int repeatCount)
 {
-  int8_t i = findFreeEventIndex();
+  RTCEvent event;
+  event._contextCallback = callback;
+  event._context = context;
+  event._hasContext = true;
+  return addEvent(eventType, period, ts, event, repeatCount);
+}
+
+/*
+ * Add an event with the callback (and context) of "callback"
+ *
+ * Only the callback fields of "callback" are used.
+ */
+RTCEventHandle RTCTimer::addEvent(enum RTCEvent::RTCEventType eventType, uint32_t period,
+    uint32_t ts, const RTCEvent & callback, int repeatCount)
+{
+  int8_t i;
+  if (eventType == RTCEvent::RTCEvent_At) {
+    for (i = 0; i < (int8_t)(sizeof(_events) / sizeof(_events[0])); ++i) {
+      RTCEvent *ev = &_events[i];
+      if (ev->_eventType == RTCEvent::RTCEvent_At && ev->sameCallback(callback)) {
+        if ((int32_t)(ts - ev->_lastEventTime) < 0) {
+          ev->_lastEventTime = ts;
+          sortEvents();
+        }
+        return ((RTCEventHandle)ev->_generation << 8) | i;
+      }
+    }
+  }
+
+  i = findFreeEventIndex();
   if (i == -1)
     return -1;
 
-  _events[i]._eventType = RTCEvent::RTCEvent_Every;
-  _events[i]._period = period;
-  _events[i]._repeatCount = repeatCount;
-  _events[i]._callback = callback;
-  _events[i]._lastEventTime = _now ? _now() : 0;
-  _events[i]._count = 0;
+  RTCEvent *ev = &_events[i];
+  ev->_eventType = eventType;
+  ev->_period = period;
+  ev->_repeatCount = repeatCount;
+  if (callback._hasContext) {
+    ev->_contextCallback = callback._contextCallback;
+  } else {
+    ev->_callback = callback._callback;
+  }
+  ev->_context = callback._context;
+  ev->_hasContext = callback._hasContext;
+  ev->_lastEventTime = ts;
+  ev->_count = 0;
+  ev->_nrLate = 0;
+  ev->_nrSkipped = 0;
+  ev->_maxLate = 0;
+  ev->_generation = (ev->_generation + 1) & 0x7F;
+
+  sortEvents();
+  return ((RTCEventHandle)ev->_generation << 8) | i;
+}
 
-  return i;
+/*
+ * Remove an event
+ *
+ * The return value is false if the event did not exist (anymore).
+ */
+bool RTCTimer::cancel(RTCEventHandle handle)
+{
+  RTCEvent *ev = findEvent(handle);
+  if (!ev) {
+    return false;
+  }
+  ev->_eventType = RTCEvent::RTCEvent_None;
+  sortEvents();
+  return true;
+}
+
+/*
+ * Change the next time of an event to timestamp ts
+ *
+ * A periodic event continues with its period from there.
+ */
+bool RTCTimer::reschedule(RTCEventHandle handle, uint32_t ts)
+{
+  RTCEvent *ev = findEvent(handle);
+  if (!ev) {
+    return false;
+  }
+  ev->_lastEventTime = ts - ev->_period;
+  sortEvents();
+  return true;
 }
 
 /*
@@ -98,10 +247,12 @@ int8_t RTCTimer::every(uint32_t period, void (*callback)(uint32_t now),
 void RTCTimer::resetAll(uint32_t now)
 {
   for (uint8_t i = 0; i < sizeof(_events) / sizeof(_events[0]); ++i) {
-    if (_events[i]._eventType != RTCEvent::RTCEvent_None) {
+    // One-shot events keep their timestamp
+    if (_events[i]._eventType == RTCEvent::RTCEvent_Every) {
       _events[i]._lastEventTime = now;
     }
   }
+  sortEvents();
 }
 
 void RTCTimer::adjust(uint32_t old, uint32_t now)
@@ -120,6 +271,7 @@ void RTCTimer::adjust(uint32_t old, uint32_t now)
       }
     }
   }
+  sortEvents();
 }
 
 void RTCTimer::update()
@@ -130,18 +282,85 @@ void RTCTimer::update()
   }
 }
 
+/*
+ * Execute all the events that are due, in the order of their next time
+ *
+ * If there is a now callback the time is read again after each event. A
+ * callback can take a while, or it can set the clock and call adjust().
+ * The events are then moved to the new clock, and the old now would make
+ * them due too early or too late.
+ */
 void RTCTimer::update(uint32_t now)
 {
-  for (uint8_t i = 0; i < sizeof(_events) / sizeof(_events[0]); ++i) {
-    if (_events[i]._eventType != RTCEvent::RTCEvent_None) {
-      if (_events[i].update(now)) {
-        // Only one event action per update.
-        break;
+  while (_nrEvents != 0) {
+    // The first in the ordered list is the one that is due first.
+    // If that one isn't due yet, none of them is.
+    RTCEvent *ev = &_events[_order[0]];
+    if ((int32_t)(now - ev->getNextTime()) < 0) {
+      break;
+    }
+    ev->update(now);
+    sortEvents();
+    if (_now) {
+      uint32_t newNow = _now();
+      if (newNow) {
+        now = newNow;
       }
     }
   }
 }
 
+/*
+ * Return the time of the first event that is due
+ *
+ * Only call this if there are events (see hasEvents()).
+ */
+uint32_t RTCTimer::getNextEventTime() const
+{
+  return _events[_order[0]].getNextTime();
+}
+
+/*
+ * Return the number of seconds until the first event that is due
+ *
+ * The result is 0 if an event is already due. If there are no events at all
+ * the result is the maximum value, there is nothing to wait for.
+ */
+uint32_t RTCTimer::getSecondsUntilNextEvent(uint32_t now) const
+{
+  if (_nrEvents == 0) {
+    return (uint32_t)-1;
+  }
+  int32_t diff = getNextEventTime() - now;
+  if (diff < 0) {
+    return 0;
+  }
+  return diff;
+}
+
+/*
+ * Make the ordered list of active events, sorted by their next time
+ *
+ * There are only a few events, so a simple insertion sort will do. It
+ * must be called after each change of the events.
+ */
+void RTCTimer::sortEvents()
+{
+  _nrEvents = 0;
+  for (uint8_t i = 0; i < sizeof(_events) / sizeof(_events[0]); ++i) {
+    if (_events[i]._eventType == RTCEvent::RTCEvent_None) {
+      continue;
+    }
+    uint32_t nextTime = _events[i].getNextTime();
+    uint8_t j = _nrEvents++;
+    while (j > 0 && (int32_t)(nextTime - _events[_order[j - 1]].getNextTime()) < 0) {
+      _order[j] = _order[j - 1];
+      --j;
+    }
+    _order[j] = i;
+  }
+}
+
 int8_t RTCTimer::findFreeEventIndex()
 {
   for (uint8_t i = 0; i < sizeof(_events) / sizeof(_events[0]); ++i) {
@@ -151,3 +370,22 @@ int8_t RTCTimer::findFreeEventIndex()
   }
   return -1;
 }
+
+/*
+ * Find the active event of a handle
+ */
+RTCEvent * RTCTimer::findEvent(RTCEventHandle handle) const
+{
+  if (handle < 0) {
+    return 0;
+  }
+  uint8_t i = handle & 0xFF;
+  if (i >= sizeof(_events) / sizeof(_events[0])) {
+    return 0;
+  }
+  RTCEvent *ev = const_cast<RTCEvent *>(&_events[i]);
+  if (ev->_eventType == RTCEvent::RTCEvent_None || ev->_generation != (handle >> 8)) {
+    return 0;
+  }
+  return ev;
+}
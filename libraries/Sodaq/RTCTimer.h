@@ -25,6 +25,14 @@
 
 #define MAX_NUMBER_OF_RTCEVENTS (10)
 
+/*
+ * A handle to an event. It contains the index of the event and a
+ * generation number, so that a handle of an event that has finished
+ * cannot be mistaken for a new event in the same slot.
+ * A negative value means "no event".
+ */
+typedef int16_t RTCEventHandle;
+
 class RTCTimer;
 class RTCEvent
 {
@@ -33,18 +41,46 @@ public:
   enum RTCEventType {
     RTCEvent_None = 0,
     RTCEvent_Every,
+    RTCEvent_At,
   };
   //RTCEvent();
 
   bool update(uint32_t now);
+  uint32_t getNextTime() const { return _lastEventTime + _period; }
+
+  bool isActive() const { return _eventType != RTCEvent_None; }
+  uint32_t getPeriod() const { return _period; }
+  // Statistics, to see if the events are executed in time
+  uint16_t getNrLate() const { return _nrLate; }
+  uint16_t getNrSkipped() const { return _nrSkipped; }
+  uint16_t getMaxLate() const { return _maxLate; }
 
 protected:
+  bool sameCallback(const RTCEvent & other) const
+  {
+    if (_hasContext != other._hasContext || _context != other._context) {
+      return false;
+    }
+    return _hasContext ? _contextCallback == other._contextCallback
+        : _callback == other._callback;
+  }
+
   enum RTCEventType _eventType;
   uint32_t _lastEventTime;
   uint32_t _period;
   int _count;
   int _repeatCount;
-  void (*_callback)(uint32_t now);
+  // _hasContext tells which of the two is valid
+  union {
+    void (*_callback)(uint32_t now);
+    void (*_contextCallback)(uint32_t now, void *context);
+  };
+  void *_context;
+  bool _hasContext;
+  uint8_t _generation;
+  uint16_t _nrLate;
+  uint16_t _nrSkipped;
+  uint16_t _maxLate;
 };
 
 class RTCTimer
@@ -52,7 +88,15 @@ class RTCTimer
 public:
   //RTCTimer();
 
-  int8_t every(uint32_t period, void (*callback)(uint32_t ts), int repeatCount=-1);
+  RTCEventHandle every(uint32_t period, void (*callback)(uint32_t ts), int repeatCount=-1);
+  RTCEventHandle every(uint32_t period, void (*callback)(uint32_t ts, void *context),
+      void *context, int repeatCount=-1);
+  RTCEventHandle at(uint32_t ts, void (*callback)(uint32_t ts));
+  RTCEventHandle at(uint32_t ts, void (*callback)(uint32_t ts, void *context), void *context);
+
+  bool cancel(RTCEventHandle handle);
+  bool reschedule(RTCEventHandle handle, uint32_t ts);
+  bool isActive(RTCEventHandle handle) const { return findEvent(handle) != 0; }
 
   void resetAll(uint32_t now);
   void setNowCallback(uint32_t (*now)()) { _now = now; }
@@ -60,10 +104,28 @@ public:
   void update();
   void update(uint32_t now);
 
+  bool hasEvents() const { return _nrEvents != 0; }
+  uint32_t getNextEventTime() const;
+  uint32_t getSecondsUntilNextEvent(uint32_t now) const;
+
+  const RTCEvent & getEvent(uint8_t i) const { return _events[i]; }
+
 protected:
   int8_t        findFreeEventIndex();
+  RTCEvent *    findEvent(RTCEventHandle handle) const;
+  RTCEventHandle addEvent(enum RTCEvent::RTCEventType eventType, uint32_t period,
+      uint32_t ts, void (*callback)(uint32_t ts), int repeatCount);
+  RTCEventHandle addEvent(enum RTCEvent::RTCEventType eventType, uint32_t period,
+      uint32_t ts, void (*callback)(uint32_t ts, void *context), void *context,
+      int repeatCount);
+  RTCEventHandle addEvent(enum RTCEvent::RTCEventType eventType, uint32_t period,
+      uint32_t ts, const RTCEvent & callback, int repeatCount);
+  void          sortEvents();
   uint32_t      (*_now)();
   RTCEvent      _events[MAX_NUMBER_OF_RTCEVENTS];
+  // Indices of the active events, ordered by their next time
+  uint8_t       _order[MAX_NUMBER_OF_RTCEVENTS];
+  uint8_t       _nrEvents;
 };
 
 #endif /* RTCTIMER_H_ */
@@ -44,6 +44,7 @@
 Sodaq_BMP085::Sodaq_BMP085()
 {
   oversampling = BMP085_ULTRAHIGHRES;
+  lastB5Valid = false;
 }
 
 void Sodaq_BMP085::begin(uint8_t mode)
@@ -90,23 +91,14 @@ void Sodaq_BMP085::begin(uint8_t mode)
 
 uint16_t Sodaq_BMP085::readRawTemperature(void)
 {
-  if ((ac1 == 0 || ac1 == -1) && (mb == 0 || mb == -1)) {
-    // The device parameters were not read properly, or begin() was never executed
-    begin(oversampling);
-  }
-  write8(BMP085_CONTROL, BMP085_READTEMPCMD);
+  startRawTemperature();
   _delay_ms(5);
-#if BMP085_ENABLE_DIAG
-  Serial.print("Raw temp: "); Serial.println(read16(BMP085_TEMPDATA));
-#endif
-  return read16(BMP085_TEMPDATA);
+  return getRawTemperature();
 }
 
 uint32_t Sodaq_BMP085::readRawPressure(void)
 {
-  uint32_t raw;
-
-  write8(BMP085_CONTROL, BMP085_READPRESSURECMD + (oversampling << 6));
+  startRawPressure();
 
   if (oversampling == BMP085_ULTRALOWPOWER)
     _delay_ms(5);
@@ -117,6 +109,60 @@ uint32_t Sodaq_BMP085::readRawPressure(void)
   else
     _delay_ms(26);
 
+  return getRawPressure();
+}
+
+/*
+ * Start a temperature conversion
+ *
+ * Use isConversionDone() to see when it is finished and then
+ * getRawTemperature() to read the value.
+ */
+void Sodaq_BMP085::startRawTemperature(void)
+{
+  checkCalibration();
+  write8(BMP085_CONTROL, BMP085_READTEMPCMD);
+  convTime = 5;
+  convStart = millis();
+}
+
+/*
+ * Start a pressure conversion
+ *
+ * Use isConversionDone() to see when it is finished and then
+ * getRawPressure() to read the value.
+ */
+void Sodaq_BMP085::startRawPressure(void)
+{
+  write8(BMP085_CONTROL, BMP085_READPRESSURECMD + (oversampling << 6));
+  convTime = conversionTime();
+  convStart = millis();
+}
+
+/*
+ * Is the started conversion finished?
+ *
+ * The EOC pin is not connected, so this goes by the maximum
+ * conversion time from the data sheet.
+ */
+bool Sodaq_BMP085::isConversionDone(void)
+{
+  // Add one, we don't know where in the current millisecond we started
+  return (uint16_t)((uint16_t)millis() - convStart) >= (uint16_t)(convTime + 1);
+}
+
+uint16_t Sodaq_BMP085::getRawTemperature(void)
+{
+#if BMP085_ENABLE_DIAG
+  Serial.print("Raw temp: "); Serial.println(read16(BMP085_TEMPDATA));
+#endif
+  return read16(BMP085_TEMPDATA);
+}
+
+uint32_t Sodaq_BMP085::getRawPressure(void)
+{
+  uint32_t raw;
+
   raw = read16(BMP085_PRESSUREDATA);
 
   raw <<= 8;
@@ -138,6 +184,28 @@ uint32_t Sodaq_BMP085::readRawPressure(void)
   return raw;
 }
 
+/*
+ * The maximum conversion time of pressure for the current oversampling
+ */
+uint8_t Sodaq_BMP085::conversionTime(void)
+{
+  if (oversampling == BMP085_ULTRALOWPOWER)
+    return 5;
+  else if (oversampling == BMP085_STANDARD)
+    return 8;
+  else if (oversampling == BMP085_HIGHRES)
+    return 14;
+  return 26;
+}
+
+void Sodaq_BMP085::checkCalibration(void)
+{
+  if ((ac1 == 0 || ac1 == -1) && (mb == 0 || mb == -1)) {
+    // The device parameters were not read properly, or begin() was never executed
+    begin(oversampling);
+  }
+}
+
 /*
  * Do some precalculation for temperature (B5)
  *
@@ -167,19 +235,18 @@ int32_t Sodaq_BMP085::readPressure(void)
 {
   int32_t UT;
   int32_t UP;
-  int32_t B3;
-  int32_t B5;
-  int32_t B6;
-  int32_t X1;
-  int32_t X2;
-  int32_t X3;
-  int32_t p;
-  uint32_t B4;
-  uint32_t B7;
 
   UT = readRawTemperature();
   UP = readRawPressure();
 
+  return calcPressure(UT, UP);
+}
+
+/*
+ * Calculate true pressure, in Pa, from the raw temperature and pressure
+ */
+int32_t Sodaq_BMP085::calcPressure(int32_t UT, int32_t UP)
+{
 #if BMP085_DEBUG == 1
   // use datasheet numbers!
   UT = 27898;
@@ -198,7 +265,22 @@ int32_t Sodaq_BMP085::readPressure(void)
 #endif
 
   // do temperature calculations
-  B5 = computeB5(UT);
+  return calcPressureB5(computeB5(UT), UP);
+}
+
+/*
+ * Calculate true pressure, in Pa, from B5 and the raw pressure
+ */
+int32_t Sodaq_BMP085::calcPressureB5(int32_t B5, int32_t UP)
+{
+  int32_t B3;
+  int32_t B6;
+  int32_t X1;
+  int32_t X2;
+  int32_t X3;
+  int32_t p;
+  uint32_t B4;
+  uint32_t B7;
 
   // do pressure calcs
   B6 = B5 - 4000;
@@ -261,11 +343,14 @@ int32_t Sodaq_BMP085::readPressure(void)
  */
 float Sodaq_BMP085::readTemperature(void)
 {
-  int32_t UT, B5;
-  float temp;
-
-  UT = readRawTemperature();
+  return calcTemperature(readRawTemperature());
+}
 
+/*
+ * Calculate true temperature from the raw temperature
+ */
+float Sodaq_BMP085::calcTemperature(int32_t UT)
+{
 #if BMP085_DEBUG == 1
   // use datasheet numbers!
   UT = 27898;
@@ -276,13 +361,120 @@ float Sodaq_BMP085::readTemperature(void)
 #endif
 
   // step 1
-  B5 = computeB5(UT);
-  temp = (B5 + 8) >> 4;
+  return calcTemperatureB5(computeB5(UT));
+}
+
+float Sodaq_BMP085::calcTemperatureB5(int32_t B5)
+{
+  float temp;
+
+  temp = calcTemperatureX10B5(B5);
   temp /= 10;
 
   return temp;
 }
 
+/*
+ * Calculate temperature from B5, in 0.1 degrees Celcius
+ */
+int16_t Sodaq_BMP085::calcTemperatureX10B5(int32_t B5)
+{
+  return (B5 + 8) >> 4;
+}
+
+/*
+ * Remember B5 of a new temperature conversion
+ *
+ * If UT is 0 (no new conversion) the remembered B5 is kept. The return
+ * value is false if there is no B5 at all.
+ */
+bool Sodaq_BMP085::updateB5(int32_t UT)
+{
+  if (UT != 0) {
+    lastB5 = computeB5(UT);
+    lastB5Valid = true;
+  }
+  return lastB5Valid;
+}
+
+/*
+ * Read temperature and pressure, with just one conversion each
+ *
+ * The readTemperature() and readPressure() pair does the temperature
+ * conversion twice. B5 (the temperature compensation) is remembered.
+ * If reuseB5 is true and there was an earlier measurement, the temperature
+ * conversion is skipped altogether and the remembered B5 is used. This
+ * is meant for a burst of pressure reads, where the temperature hardly
+ * changes.
+ * The temperature is in degrees Celcius, the pressure in Pa.
+ * The return value is false if there is no temperature compensation.
+ */
+bool Sodaq_BMP085::readTemperaturePressure(float *temperature, int32_t *pressure, bool reuseB5)
+{
+  int32_t UT = 0;
+  if (!reuseB5 || !lastB5Valid) {
+    UT = readRawTemperature();
+  }
+  return calcTemperaturePressure(UT, readRawPressure(), temperature, pressure);
+}
+
+/*
+ * Same as readTemperaturePressure(), but without floating point
+ *
+ * The temperature is in 0.1 degrees Celcius, the pressure in 0.1 hPa.
+ */
+bool Sodaq_BMP085::readTemperaturePressureX10(int16_t *temperature, uint16_t *pressure, bool reuseB5)
+{
+  int32_t UT = 0;
+  if (!reuseB5 || !lastB5Valid) {
+    UT = readRawTemperature();
+  }
+  return calcTemperaturePressureX10(UT, readRawPressure(), temperature, pressure);
+}
+
+/*
+ * Same as calcTemperaturePressure(), but without floating point
+ *
+ * The temperature is in 0.1 degrees Celcius, the pressure in 0.1 hPa.
+ */
+bool Sodaq_BMP085::calcTemperaturePressureX10(int32_t UT, int32_t UP, int16_t *temperature, uint16_t *pressure)
+{
+  if (!updateB5(UT)) {
+    return false;
+  }
+
+  if (temperature) {
+    *temperature = calcTemperatureX10B5(lastB5);
+  }
+  if (pressure) {
+    *pressure = calcPressureB5(lastB5, UP) / 10;
+  }
+  return true;
+}
+
+/*
+ * Calculate temperature and pressure from the raw values
+ *
+ * This is the same as readTemperaturePressure(), but for the raw values
+ * of the non-blocking conversions. If UT is 0 the remembered B5 is used.
+ * Without a remembered B5 nothing is calculated and the return value is
+ * false.
+ */
+bool Sodaq_BMP085::calcTemperaturePressure(int32_t UT, int32_t UP, float *temperature, int32_t *pressure)
+{
+  if (!updateB5(UT)) {
+    return false;
+  }
+
+  if (temperature) {
+    *temperature = calcTemperatureB5(lastB5);
+  }
+  if (pressure) {
+    *pressure = calcPressureB5(lastB5, UP);
+  }
+  return true;
+}
+
 float Sodaq_BMP085::readAltitude(float sealevelPressure)
 {
   float altitude;
@@ -40,14 +40,41 @@ class Sodaq_BMP085 {
   float readAltitude(float sealevelPressure = 101325); // std atmosphere
   uint16_t readRawTemperature(void);
   uint32_t readRawPressure(void);
-  
+
+  // Non-blocking conversions
+  void startRawTemperature(void);
+  void startRawPressure(void);
+  bool isConversionDone(void);
+  uint16_t getRawTemperature(void);
+  uint32_t getRawPressure(void);
+  float calcTemperature(int32_t UT);
+  int32_t calcPressure(int32_t UT, int32_t UP);
+
+  // Temperature and pressure from one conversion each
+  bool readTemperaturePressure(float *temperature, int32_t *pressure, bool reuseB5 = false);
+  bool calcTemperaturePressure(int32_t UT, int32_t UP, float *temperature, int32_t *pressure);
+  // Integer versions, in 0.1 degrees Celcius and 0.1 hPa
+  bool readTemperaturePressureX10(int16_t *temperature, uint16_t *pressure, bool reuseB5 = false);
+  bool calcTemperaturePressureX10(int32_t UT, int32_t UP, int16_t *temperature, uint16_t *pressure);
+
  private:
   int32_t computeB5(int32_t UT);
+  float calcTemperatureB5(int32_t B5);
+  int16_t calcTemperatureX10B5(int32_t B5);
+  bool updateB5(int32_t UT);
+  int32_t calcPressureB5(int32_t B5, int32_t UP);
   uint8_t read8(uint8_t addr);
   uint16_t read16(uint8_t addr);
   void write8(uint8_t addr, uint8_t data);
 
+  void checkCalibration(void);
+  uint8_t conversionTime(void);
+
   uint8_t oversampling;
+  uint8_t convTime;                     // Duration of the current conversion, ms
+  uint16_t convStart;                   // The (16 bits) millis at the start
+  int32_t lastB5;                       // Temperature compensation of the last measurement
+  bool lastB5Valid;
 
   int16_t ac1, ac2, ac3, b1, b2, mb, mc, md;
   uint16_t ac4, ac5, ac6;
@@ -11,6 +11,7 @@
 #include <Wire.h>
 #include <avr/pgmspace.h>
 #include "Sodaq_DS3231.h"
+#include "Sodaq_TextBuf.h"
 #include "Arduino.h"
 
 #define EPOCH_TIME_OFF 946684800  // This is 2000-jan-01 00:00:00 in epoch time
@@ -38,7 +39,7 @@
 
 #define DS3231_CONTROL_REG          0x0E
 #define DS3231_STATUS_REG           0x0F
-#define DS3231_AGING_OFFSET_REG     0x0F
+#define DS3231_AGING_OFFSET_REG     0x10
 #define DS3231_TMP_UP_REG           0x11
 #define DS3231_TMP_LOW_REG          0x12
 
@@ -49,18 +50,31 @@
 ////////////////////////////////////////////////////////////////////////////////
 // utility code, some of this could be exposed in the DateTime API if needed
 
-static const uint8_t daysInMonth [] PROGMEM = { 31,28,31,30,31,30,31,31,30,31,30,31 };
+/*
+ * The date conversions count years from March, so that the leap day is
+ * the last day of the year. Within 2000..2099 every fourth year is a
+ * leap year. A 4 year cycle then has 1461 days, and the leap day is the
+ * last day of the cycle. The cycles start at 1996-03-01, which is day
+ * -1401 (2000-01-01 is day 0).
+ * The days of the months from March are 31,30,31,30,31, 31,30,31,30,31,
+ * 31,28/29. (153 * mp + 2) / 5 gives the first day of month mp (0 is
+ * March) in the year.
+ */
+#define DAYS_1996_MAR_TO_2000   1401
 
-// number of days since 2000/01/01, valid for 2001..2099
+// number of days since 2000/01/01, valid for 2000..2099
 static uint16_t date2days(uint16_t y, uint8_t m, uint8_t d) {
     if (y >= 2000)
         y -= 2000;
-    uint16_t days = d;
-    for (uint8_t i = 1; i < m; ++i)
-        days += pgm_read_byte(daysInMonth + i - 1);
-    if (m > 2 && y % 4 == 0)
-        ++days;
-    return days + 365 * y + (y + 3) / 4 - 1;
+    uint8_t mp = m > 2 ? m - 3 : m + 9;
+    uint16_t yp = y + 4 - (m <= 2);     // March years since 1996
+    uint16_t doy = (153 * mp + 2) / 5 + d - 1;
+    return (yp / 4) * 1461 + (yp % 4) * 365 + doy - DAYS_1996_MAR_TO_2000;
+}
+
+// the day of the week (Su=1 .. Sa=7) of the number of days since 2000/01/01
+static uint8_t days2wday(uint16_t days) {
+    return (days + 6) % 7 + 1;          // 2000/01/01 was a Saturday
 }
 
 static uint32_t time2long(uint16_t days, uint8_t h, uint8_t m, uint8_t s) {
@@ -85,23 +99,17 @@ DateTime::DateTime (long t) {
     t /= 60;
     hh = t % 24;
     uint16_t days = t / 24;
-    uint8_t leap;
-    for (yOff = 0; ; ++yOff) {
-        leap = yOff % 4 == 0;
-        if (days < 365 + leap)
-            break;
-        days -= 365 + leap;
-    }
-    for (m = 1; ; ++m) {
-        uint8_t daysPerMonth = pgm_read_byte(daysInMonth + m - 1);
-        if (leap && m == 2)
-            ++daysPerMonth;
-        if (days < daysPerMonth)
-            break;
-        days -= daysPerMonth;
-    }
-    d = days + 1;
-    wday = 0;         // FIXME This is not properly initialized
+    wday = days2wday(days);
+
+    // See date2days
+    uint16_t z = days + DAYS_1996_MAR_TO_2000;
+    uint16_t doc = z % 1461;                    // day of the cycle
+    uint8_t yoc = (doc - doc / 1460) / 365;     // year of the cycle
+    uint16_t doy = doc - 365 * yoc;             // day of the (March) year
+    uint8_t mp = (5 * doy + 2) / 153;           // month, 0 is March
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    yOff = (z / 1461) * 4 + yoc + (m <= 2) - 4;
 }
 
 DateTime::DateTime (uint16_t year, uint8_t month, uint8_t date, uint8_t hour, uint8_t min, uint8_t sec, uint8_t wd) {
@@ -137,7 +145,7 @@ DateTime::DateTime (const char* date, const char* time) {
     hh = conv2d(time);
     mm = conv2d(time + 3);
     ss = conv2d(time + 6);
-    wday = 0;         // FIXME This is not properly initialized
+    wday = days2wday(date2days(yOff, m, d));
 }
 
 uint32_t DateTime::get() const {
@@ -150,43 +158,19 @@ uint32_t DateTime::getEpoch() const
     return get() + EPOCH_TIME_OFF;
 }
 
-/*
- * Format an integer as %0*d
- *
- * Arduino formatting sucks.
- */
-static void add0Nd(String &str, uint16_t val, size_t width)
+void DateTime::addToString(TextBuf & str) const
 {
-    if (width >= 5 && val < 1000) {
-	str += '0';
-    }
-    if (width >= 4 && val < 100) {
-	str += '0';
-    }
-    if (width >= 3 && val < 100) {
-	str += '0';
-    }
-    if (width >= 2 && val < 10) {
-	str += '0';
-    }
-    str += val;
-}
-static inline void add04d(String &str, uint16_t val) { add0Nd(str, val, 4); }
-static inline void add02d(String &str, uint16_t val) { add0Nd(str, val, 2); }
-
-void DateTime::addToString(String & str) const
-{
-    add04d(str, year());
-    str += '-';
-    add02d(str, month());
-    str += '-';
-    add02d(str, date());
-    str += ' ';
-    add02d(str, hour());
-    str += ':';
-    add02d(str, minute());
-    str += ':';
-    add02d(str, second());
+    str.add04d(year());
+    str.add('-');
+    str.add02d(month());
+    str.add('-');
+    str.add02d(date());
+    str.add(' ');
+    str.add02d(hour());
+    str.add(':');
+    str.add02d(minute());
+    str.add(':');
+    str.add02d(second());
 }
 
 static uint8_t bcd2bin (uint8_t val) { return val - 6 * (val >> 4); }
@@ -392,4 +376,30 @@ float Sodaq_DS3231::getTemperature()
       
 }
 
+//Read the temperature value from the register, in 0.1 deg C, without floating point
+int16_t Sodaq_DS3231::getTemperatureX10()
+{
+    int8_t tUBYTE  = readRegister(DS3231_TMP_UP_REG);   //Two's complement form
+    uint8_t tLRBYTE = readRegister(DS3231_TMP_LOW_REG); //Fractional part, in 0.25 deg C
+
+    // The combined value is in 0.25 deg C
+    int16_t quarters = (int16_t)tUBYTE * 4 + (tLRBYTE >> 6);
+    return (quarters * 10) / 4;
+}
+
+//Read the aging offset, in about 0.1 ppm
+int8_t Sodaq_DS3231::getAgingOffset()
+{
+    return readRegister(DS3231_AGING_OFFSET_REG);
+}
+
+//Change the aging offset, in about 0.1 ppm (at 25 deg C). A positive value
+//slows the oscillator down. It is used after the next temperature conversion,
+//so we do one right away.
+void Sodaq_DS3231::setAgingOffset(int8_t offset)
+{
+    writeRegister(DS3231_AGING_OFFSET_REG, offset);
+    convertTemperature();
+}
+
 Sodaq_DS3231 rtc;
@@ -13,6 +13,8 @@
 
 #include <stdint.h>
 
+class TextBuf;
+
 
 
 
@@ -39,7 +41,7 @@ public:
     // 32-bit number of seconds since Unix epoch (1970-01-01)
     uint32_t getEpoch() const;
 
-    void addToString(String & str) const;
+    void addToString(TextBuf & str) const;
 
 protected:
     uint8_t yOff, m, d, hh, mm, ss, wday;
@@ -66,6 +68,10 @@ public:
 
     void convertTemperature();
     float getTemperature();
+    int16_t getTemperatureX10();
+
+    int8_t getAgingOffset();
+    void setAgingOffset(int8_t offset);
 private:
     uint8_t readRegister(uint8_t regaddress);
     void writeRegister(uint8_t regaddress, uint8_t value);
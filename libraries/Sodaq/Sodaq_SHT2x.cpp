@@ -59,7 +59,73 @@ typedef enum {
  **********************************************************/
 float SHT2xClass::GetHumidity(void)
 {
-    float value = readSensor(eRHumidityHoldCmd);
+    return calcHumidity(readSensor(eRHumidityHoldCmd));
+}
+
+/**********************************************************
+ * GetTemperature
+ *  Gets the current temperature from the sensor.
+ *
+ * @return float - The temperature in Deg C
+ **********************************************************/
+float SHT2xClass::GetTemperature(void)
+{
+    return calcTemperature(readSensor(eTempHoldCmd));
+}
+
+/**********************************************************
+ * startTemperature
+ *  Start a temperature measurement, without holding the
+ *  I2C bus. Use readResult() to get the raw value.
+ **********************************************************/
+void SHT2xClass::startTemperature(void)
+{
+    Wire.beginTransmission(eSHT2xAddress);
+    Wire.write(eTempNoHoldCmd);
+    Wire.endTransmission();
+}
+
+/**********************************************************
+ * startHumidity
+ *  Start a humidity measurement, without holding the
+ *  I2C bus. Use readResult() to get the raw value.
+ **********************************************************/
+void SHT2xClass::startHumidity(void)
+{
+    Wire.beginTransmission(eSHT2xAddress);
+    Wire.write(eRHumidityNoHoldCmd);
+    Wire.endTransmission();
+}
+
+/**********************************************************
+ * readResult
+ *  Read the result of a started measurement. While the
+ *  sensor is still busy it does not acknowledge the read.
+ *
+ * @return uint16_t - The raw value, or 0 if not ready
+ **********************************************************/
+uint16_t SHT2xClass::readResult(void)
+{
+    uint16_t result;
+
+    if (Wire.requestFrom(eSHT2xAddress, 3) < 3) {
+        return 0;
+    }
+    result = Wire.read() << 8;
+    result += Wire.read();
+    Wire.read();                        // Skip the checksum
+    result &= ~0x0003;   // clear two low bits (status bits)
+    return result;
+}
+
+/**********************************************************
+ * calcHumidity
+ *  Convert a raw value to humidity
+ *
+ * @return float - The relative humidity in %RH
+ **********************************************************/
+float SHT2xClass::calcHumidity(uint16_t value)
+{
     if (value == 0) {
         return 0;                       // Some unrealistic value
     }
@@ -67,20 +133,85 @@ float SHT2xClass::GetHumidity(void)
 }
 
 /**********************************************************
- * GetTemperature
- *  Gets the current temperature from the sensor.
+ * calcTemperature
+ *  Convert a raw value to temperature
  *
  * @return float - The temperature in Deg C
  **********************************************************/
-float SHT2xClass::GetTemperature(void)
+float SHT2xClass::calcTemperature(uint16_t value)
 {
-    float value = readSensor(eTempHoldCmd);
     if (value == 0) {
         return -273;                    // Roughly Zero Kelvin indicates an error
     }
     return -46.85 + 175.72 / 65536.0 * value;
 }
 
+/**********************************************************
+ * GetHumidityX10
+ *  Gets the current humidity from the sensor.
+ *
+ * @return uint16_t - The relative humidity in 0.1 %RH
+ **********************************************************/
+uint16_t SHT2xClass::GetHumidityX10(void)
+{
+    return calcHumidityX10(readSensor(eRHumidityHoldCmd));
+}
+
+/**********************************************************
+ * GetTemperatureX10
+ *  Gets the current temperature from the sensor.
+ *
+ * @return int16_t - The temperature in 0.1 Deg C
+ **********************************************************/
+int16_t SHT2xClass::GetTemperatureX10(void)
+{
+    return calcTemperatureX10(readSensor(eTempHoldCmd));
+}
+
+/**********************************************************
+ * calcHumidityX10
+ *  Convert a raw value to humidity, without floating point
+ *
+ *  RH * 10 = -60 + 1250 * value / 2^16
+ *  The result is the exact truncation of the formula. The float
+ *  version multiplied by 10 and converted to an integer can be one
+ *  less, because of its rounding errors.
+ *
+ * @return uint16_t - The relative humidity in 0.1 %RH
+ **********************************************************/
+uint16_t SHT2xClass::calcHumidityX10(uint16_t value)
+{
+    if (value == 0) {
+        return 0;                       // Some unrealistic value
+    }
+    int32_t rh = ((int32_t)1250 * value - 60L * 65536) / 65536;
+    if (rh < 0) {
+        // Can happen for very low raw values
+        rh = 0;
+    }
+    return rh;
+}
+
+/**********************************************************
+ * calcTemperatureX10
+ *  Convert a raw value to temperature, without floating point
+ *
+ *  T * 10 = -468.5 + 1757.2 * value / 2^16
+ *  The numerator is multiplied by 10 to avoid the fractions.
+ *  The result is the exact truncation of the formula. The float
+ *  version multiplied by 10 and converted to an integer can be one
+ *  less, because of its rounding errors.
+ *
+ * @return int16_t - The temperature in 0.1 Deg C
+ **********************************************************/
+int16_t SHT2xClass::calcTemperatureX10(uint16_t value)
+{
+    if (value == 0) {
+        return -2730;                   // Roughly Zero Kelvin indicates an error
+    }
+    return ((int32_t)17572 * value - 4685L * 65536) / (10L * 65536);
+}
+
 
 /******************************************************************************
  * Private Functions
@@ -42,6 +42,19 @@ class SHT2xClass
   public:
     float GetHumidity(void);
     float GetTemperature(void);
+
+    // Non-blocking measurements, using the "no hold master" commands
+    void startTemperature(void);
+    void startHumidity(void);
+    uint16_t readResult(void);
+    static float calcTemperature(uint16_t value);
+    static float calcHumidity(uint16_t value);
+
+    // Integer versions, in 0.1 degrees Celcius and 0.1 %RH
+    int16_t GetTemperatureX10(void);
+    uint16_t GetHumidityX10(void);
+    static int16_t calcTemperatureX10(uint16_t value);
+    static uint16_t calcHumidityX10(uint16_t value);
 };
 
 extern SHT2xClass SHT2x;
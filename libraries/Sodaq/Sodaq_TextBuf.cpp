@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2014 Kees Bakker.  All rights reserved.
+ *
+ * This file is part of Sodaq_TextBuf.
+ *
+ * Sodaq_TextBuf is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or(at your option) any later version.
+ *
+ * Sodaq_TextBuf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sodaq_TextBuf.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "Sodaq_TextBuf.h"
+
+TextBuf::TextBuf(char *buf, size_t size)
+{
+  _buf = buf;
+  _size = size;
+  clear();
+}
+
+void TextBuf::clear()
+{
+  _len = 0;
+  _buf[0] = '\0';
+  _truncated = false;
+}
+
+void TextBuf::add(char c)
+{
+  if (_len + 1 >= _size) {
+    _truncated = true;
+    return;
+  }
+  _buf[_len++] = c;
+  _buf[_len] = '\0';
+}
+
+void TextBuf::add(const char *str)
+{
+  while (*str) {
+    add(*str++);
+  }
+}
+
+void TextBuf::add(const __FlashStringHelper *str)
+{
+  addP(reinterpret_cast<PGM_P>(str));
+}
+
+void TextBuf::addP(PGM_P ptr)
+{
+  char c;
+  while ((c = pgm_read_byte_near(ptr++)) != '\0') {
+    add(c);
+  }
+}
+
+void TextBuf::add(long val)
+{
+  char digits[12];
+  ltoa(val, digits, 10);
+  add(digits);
+}
+
+void TextBuf::add(unsigned long val)
+{
+  char digits[11];
+  ultoa(val, digits, 10);
+  add(digits);
+}
+
+/*
+ * Add the digits, with leading zeros up to the width
+ */
+void TextBuf::addDigits(const char *digits, uint8_t width)
+{
+  for (uint8_t n = strlen(digits); n < width; ++n) {
+    add('0');
+  }
+  add(digits);
+}
+
+/*
+ * Format an integer as %0*d
+ */
+void TextBuf::add0Nd(uint16_t val, uint8_t width)
+{
+  char digits[6];
+  utoa(val, digits, 10);
+  addDigits(digits, width);
+}
+
+/*
+ * Format an integer as %0*x
+ */
+void TextBuf::add0Nx(uint16_t val, uint8_t width)
+{
+  char digits[5];
+  utoa(val, digits, 16);
+  addDigits(digits, width);
+}
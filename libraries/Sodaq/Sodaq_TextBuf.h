@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2014 Kees Bakker.  All rights reserved.
+ *
+ * This file is part of Sodaq_TextBuf.
+ *
+ * Sodaq_TextBuf is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or(at your option) any later version.
+ *
+ * Sodaq_TextBuf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sodaq_TextBuf.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SODAQ_TEXTBUF_H_
+#define SODAQ_TEXTBUF_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+class __FlashStringHelper;
+
+/*
+ * A text builder on top of a fixed size buffer
+ *
+ * It is a replacement of String that does not use the heap. The text
+ * is always NUL terminated. If it does not fit it is truncated and
+ * isTruncated() becomes true.
+ *
+ * Use TextBufN<size> to get one with its own buffer, for example on the
+ * stack. Functions that add text should take a TextBuf &.
+ */
+class TextBuf
+{
+public:
+  TextBuf(char *buf, size_t size);
+
+  void clear();
+  const char *c_str() const { return _buf; }
+  size_t length() const { return _len; }
+  size_t capacity() const { return _size - 1; }
+  bool isTruncated() const { return _truncated; }
+  char operator[](size_t ix) const { return _buf[ix]; }
+
+  void add(char c);
+  void add(const char *str);
+  void add(const __FlashStringHelper *str);
+  void addP(PGM_P ptr);
+  void add(int val) { add((long)val); }
+  void add(unsigned int val) { add((unsigned long)val); }
+  void add(long val);
+  void add(unsigned long val);
+
+  // To compensate for the lack of printf (due to huge increase of memory).
+  void add0Nd(uint16_t val, uint8_t width);
+  void add04d(uint16_t val) { add0Nd(val, 4); }
+  void add02d(uint16_t val) { add0Nd(val, 2); }
+  void add0Nx(uint16_t val, uint8_t width);
+  void add04x(uint16_t val) { add0Nx(val, 4); }
+  void add02x(uint16_t val) { add0Nx(val, 2); }
+
+private:
+  void addDigits(const char *digits, uint8_t width);
+
+  char *_buf;
+  size_t _size;
+  size_t _len;
+  bool _truncated;
+};
+
+template <size_t SIZE>
+class TextBufN : public TextBuf
+{
+public:
+  TextBufN() : TextBuf(_data, SIZE) {}
+private:
+  char _data[SIZE];
+};
+
+#endif /* SODAQ_TEXTBUF_H_ */
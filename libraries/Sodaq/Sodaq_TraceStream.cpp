@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2014 Kees Bakker.  All rights reserved.
+ *
+ * This file is part of Sodaq_TraceStream.
+ *
+ * Sodaq_TraceStream is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or(at your option) any later version.
+ *
+ * Sodaq_TraceStream is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sodaq_TraceStream.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The TraceStream records the traffic of a Stream. It is meant to
+ * see what happens between the application and a modem, how long it
+ * takes, how many bytes are sent and how many commands.
+ *
+ * A simple example of its usage is as follows:
+ *
+ *   uint8_t traceBuffer[1024];
+ *   TraceStream beeTrace(Serial1, traceBuffer, sizeof(traceBuffer));
+ *
+ *   gprsbee.init(beeTrace, BEECTS, BEEDTR);
+ *   ...
+ *   beeTrace.clear();
+ *   gprsbee.doHTTPGET(...);
+ *   beeTrace.showStats(Serial);
+ *   beeTrace.dump(Serial);
+ */
+
+#include <Arduino.h>
+
+#include "Sodaq_TraceStream.h"
+
+#define TRACE_DIR_TX    0x00
+#define TRACE_DIR_RX    0x80
+#define TRACE_CNT_MASK  0x7F
+#define TRACE_HDR_SIZE  3
+#define TRACE_NO_HDR    ((size_t)-1)
+#define TRACE_GAP_MS    20
+
+TraceStream::TraceStream(Stream &stream, uint8_t *buffer, size_t size)
+{
+  _stream = &stream;
+  _buffer = buffer;
+  _size = size;
+  clear();
+}
+
+/*
+ * Start a new session, forget everything that was recorded
+ */
+void TraceStream::clear()
+{
+  _len = 0;
+  _curHdr = TRACE_NO_HDR;
+  _startMs = millis();
+  _lastMs = _startMs;
+  _byteMs = _startMs;
+  _nrSent = 0;
+  _nrReceived = 0;
+  _nrCommands = 0;
+  _overflow = false;
+}
+
+int TraceStream::available()
+{
+  return _stream->available();
+}
+
+int TraceStream::read()
+{
+  int c = _stream->read();
+  if (c >= 0) {
+    ++_nrReceived;
+    record(TRACE_DIR_RX, c);
+  }
+  return c;
+}
+
+int TraceStream::peek()
+{
+  return _stream->peek();
+}
+
+void TraceStream::flush()
+{
+  _stream->flush();
+}
+
+size_t TraceStream::write(uint8_t c)
+{
+  ++_nrSent;
+  if (c == '\r') {
+    ++_nrCommands;
+  }
+  record(TRACE_DIR_TX, c);
+  return _stream->write(c);
+}
+
+/*
+ * Add one byte to the log
+ *
+ * A new record is started when the direction changes, when the
+ * current record is full, or after a pause. Without the latter a reply
+ * and a URC that comes seconds later would end up in one record, and a
+ * replay would lose that pause.
+ */
+void TraceStream::record(uint8_t dir, uint8_t c)
+{
+  if (_overflow) {
+    return;
+  }
+  uint32_t now = millis();
+  if (_curHdr == TRACE_NO_HDR
+      || (_buffer[_curHdr] & ~TRACE_CNT_MASK) != dir
+      || (_buffer[_curHdr] & TRACE_CNT_MASK) == TRACE_CNT_MASK
+      || now - _byteMs >= TRACE_GAP_MS) {
+    if (_len + TRACE_HDR_SIZE >= _size) {
+      _overflow = true;
+      return;
+    }
+    uint32_t dt = now - _lastMs;
+    if (dt > 0xFFFF) {
+      dt = 0xFFFF;
+    }
+    _lastMs = now;
+    _curHdr = _len;
+    _buffer[_len++] = dir;
+    _buffer[_len++] = dt;
+    _buffer[_len++] = dt >> 8;
+  }
+  if (_len >= _size) {
+    _overflow = true;
+    return;
+  }
+  _buffer[_len++] = c;
+  ++_buffer[_curHdr];
+  _byteMs = now;
+}
+
+/*
+ * Print the recorded log in a readable form
+ *
+ * Each record is printed as
+ *   +<dt> >> <data>        (sent)
+ *   +<dt> << <data>        (received)
+ * Non printable characters are shown in hex, between angle brackets.
+ */
+void TraceStream::dump(Stream &out)
+{
+  size_t ix = 0;
+  while (ix + TRACE_HDR_SIZE <= _len) {
+    uint8_t hdr = _buffer[ix];
+    uint16_t dt = _buffer[ix + 1] | (_buffer[ix + 2] << 8);
+    uint8_t cnt = hdr & TRACE_CNT_MASK;
+    ix += TRACE_HDR_SIZE;
+
+    out.print('+');
+    out.print(dt);
+    out.print((hdr & TRACE_DIR_RX) ? F(" << ") : F(" >> "));
+    for (uint8_t i = 0; i < cnt && ix < _len; ++i, ++ix) {
+      uint8_t c = _buffer[ix];
+      if (c >= ' ' && c < 0x7f) {
+        out.print((char)c);
+      } else {
+        out.print('<');
+        if (c < 0x10) {
+          out.print('0');
+        }
+        out.print(c, HEX);
+        out.print('>');
+      }
+    }
+    out.println();
+  }
+  if (_overflow) {
+    out.println(F("(trace buffer full)"));
+  }
+}
+
+/*
+ * Print the statistics of the session
+ */
+void TraceStream::showStats(Stream &out)
+{
+  out.print(F("trace: ms="));
+  out.print(getElapsed());
+  out.print(F(" sent="));
+  out.print(_nrSent);
+  out.print(F(" received="));
+  out.print(_nrReceived);
+  out.print(F(" commands="));
+  out.println(_nrCommands);
+}
@@ -0,0 +1,82 @@
+#ifndef SODAQ_TRACESTREAM_H_
+#define SODAQ_TRACESTREAM_H_
+/*
+ * Copyright (c) 2014 Kees Bakker.  All rights reserved.
+ *
+ * This file is part of Sodaq_TraceStream.
+ *
+ * Sodaq_TraceStream is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or(at your option) any later version.
+ *
+ * Sodaq_TraceStream is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sodaq_TraceStream.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <Arduino.h>
+#include <Stream.h>
+
+/*
+ * A Stream that sits between a user (e.g. GPRSbee) and the real
+ * Stream (e.g. Serial1). Everything that goes through is recorded in
+ * a buffer, with timestamps.
+ *
+ * The log is a sequence of records:
+ *   <hdr> <dt low> <dt high> <data ...>
+ * <hdr> bit 7 is the direction (1 = received), bits 0..6 is the
+ * number of data bytes. <dt> is the number of milliseconds since
+ * the previous record.
+ * When the buffer is full the rest of the session is not recorded,
+ * but it is still counted.
+ */
+class TraceStream : public Stream
+{
+public:
+  TraceStream(Stream &stream, uint8_t *buffer, size_t size);
+
+  int available();
+  int read();
+  int peek();
+  void flush();
+  size_t write(uint8_t c);
+  using Print::write;
+
+  void clear();
+  void dump(Stream &out);
+  void showStats(Stream &out);
+
+  uint32_t getNrSent() const { return _nrSent; }
+  uint32_t getNrReceived() const { return _nrReceived; }
+  uint16_t getNrCommands() const { return _nrCommands; }
+  uint32_t getElapsed() const { return millis() - _startMs; }
+  bool isOverflow() const { return _overflow; }
+  const uint8_t *getLog() const { return _buffer; }
+  size_t getLogLength() const { return _len; }
+
+private:
+  void record(uint8_t dir, uint8_t c);
+
+  Stream *_stream;
+  uint8_t *_buffer;
+  size_t _size;
+  size_t _len;
+  size_t _curHdr;
+  uint32_t _startMs;
+  uint32_t _lastMs;
+  uint32_t _byteMs;
+  uint32_t _nrSent;
+  uint32_t _nrReceived;
+  uint16_t _nrCommands;
+  bool _overflow;
+};
+
+#endif /* SODAQ_TRACESTREAM_H_ */
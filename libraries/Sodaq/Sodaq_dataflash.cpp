@@ -24,6 +24,7 @@
  */
 
 #include <inttypes.h>
+#include <avr/interrupt.h>
 #include <Arduino.h>
 
 #include "Sodaq_dataflash.h"
@@ -34,6 +35,13 @@
 #define ReadMfgID               0x9F    // Read Manufacturer and Device ID
 #define PageErase               0x81    // Page erase
 #define ReadSecReg              0x77    // Read Security Register
+#define DeepPowerDown           0xB9    // Deep power-down
+#define ResumeFromPowerDown     0xAB    // Resume from deep power-down
+
+#define ManufacturerAtmel       0x1F
+// Status register
+#define StatusReady             0x80
+#define StatusBinaryPageSize    0x01
 
 #define FlashToBuf1Transfer     0x53    // Main memory page to buffer 1 transfer
 #define Buf1Read                0xD4    // Buffer 1 read
@@ -46,10 +54,18 @@
 #define Buf2Write               0x87    // Buffer 2 write
 
 
-void Sodaq_Dataflash::init(uint8_t misoPin, uint8_t mosiPin, uint8_t sckPin, uint8_t ssPin)
+/*
+ * Initialize the SPI and detect the chip
+ *
+ * Returns false if the chip is not recognized. The geometry of the
+ * AT45DB161D is used in that case.
+ */
+bool Sodaq_Dataflash::init(uint8_t misoPin, uint8_t mosiPin, uint8_t sckPin, uint8_t ssPin)
 {
   // setup the slave select pin
   _ssPin = ssPin;
+  _ssPort = portOutputRegister(digitalPinToPort(_ssPin));
+  _ssMask = digitalPinToBitMask(_ssPin);
   pinMode(_ssPin, OUTPUT);
 
   // setup the SPI pins
@@ -63,20 +79,86 @@ void Sodaq_Dataflash::init(uint8_t misoPin, uint8_t mosiPin, uint8_t sckPin, uin
   // configure the SPI registers
   SPCR = _BV(SPE) | _BV(MSTR);
   SPSR = _BV(SPI2X);
+  _bgBusy = false;
+
+  // After an MCU reset the chip may still be in deep power-down
+  _poweredDown = true;
 #if 0
   // TODO Do we need this?
   // clear the SPI registers
   clr = SPSR;
   clr = SPDR;
 #endif
-#if DF_VARIANT == DF_AT45DB081D
-  _pageAddrShift = 1;
-#elif DF_VARIANT == DF_AT45DB161D
-  _pageAddrShift = 1;
-#endif
+  return setGeometry();
+}
+
+/*
+ * Set the page size and the number of pages from the device ID
+ *
+ * The density code is in the lower 5 bits of the first device ID byte.
+ * The page size mode is in the status register.
+ */
+bool Sodaq_Dataflash::setGeometry()
+{
+  uint8_t id[4];
+  readID(id);
+  _binaryPageSize = (readStatus() & StatusBinaryPageSize) != 0;
+
+  bool known = id[0] == ManufacturerAtmel;
+  uint8_t pageBits;
+  switch (known ? id[1] & 0x1F : 0) {
+  case 0x05:                    // AT45DB081D, 8 Mbit
+    pageBits = 8;
+    _nrPages = 4096;
+    break;
+  case 0x06:                    // AT45DB161D, 16 Mbit
+    pageBits = 9;
+    _nrPages = 4096;
+    break;
+  case 0x07:                    // AT45DB321D, 32 Mbit
+    pageBits = 9;
+    _nrPages = 8192;
+    break;
+  case 0x08:                    // AT45DB641D, 64 Mbit
+    pageBits = 10;
+    _nrPages = 8192;
+    break;
+  default:
+    known = false;
+    pageBits = 9;
+    _nrPages = 4096;
+    break;
+  }
+
+  // A standard page is 1/32 larger and needs one more address bit
+  _pageSize = 1 << pageBits;
+  if (_binaryPageSize) {
+    _pageAddrShift = pageBits;
+  } else {
+    _pageSize += _pageSize / 32;
+    _pageAddrShift = pageBits + 1;
+  }
+  return known;
 }
 
-uint8_t Sodaq_Dataflash::transmit(uint8_t data)
+/*
+ * Switch to the binary (power of 2) page size
+ *
+ * Beware, this can only be done once. It is permanent, and it only
+ * takes effect after a power cycle of the chip.
+ */
+void Sodaq_Dataflash::setBinaryPageSize()
+{
+  activate();
+  transmit(0x3D);
+  transmit(0x2A);
+  transmit(0x80);
+  transmit(0xA6);
+  deactivate();
+  waitTillReady();
+}
+
+inline uint8_t Sodaq_Dataflash::transmit(uint8_t data)
 {
   SPDR = data; // Start the transmission
   while (!(SPSR & (1 << SPIF))) { // Wait the end of the transmission
@@ -84,6 +166,53 @@ uint8_t Sodaq_Dataflash::transmit(uint8_t data)
   return SPDR;
 }
 
+/*
+ * Receive a block of bytes
+ *
+ * The next transfer is started as soon as the previous byte is in, and
+ * the byte is stored while the next one is shifted. At fosc/2 a byte
+ * takes 16 cycles, which is more than the loop needs.
+ */
+void Sodaq_Dataflash::receiveBlock(uint8_t *data, size_t size)
+{
+  if (size == 0) {
+    return;
+  }
+  SPDR = 0;
+  while (--size) {
+    while (!(SPSR & (1 << SPIF))) {
+    }
+    uint8_t b = SPDR;
+    SPDR = 0;
+    *data++ = b;
+  }
+  while (!(SPSR & (1 << SPIF))) {
+  }
+  *data = SPDR;
+}
+
+/*
+ * Transmit a block of bytes
+ *
+ * The next byte is fetched while the previous one is shifted.
+ */
+void Sodaq_Dataflash::transmitBlock(const uint8_t *data, size_t size)
+{
+  if (size == 0) {
+    return;
+  }
+  SPDR = *data++;
+  while (--size) {
+    uint8_t b = *data++;
+    while (!(SPSR & (1 << SPIF))) {
+    }
+    SPDR = b;
+  }
+  while (!(SPSR & (1 << SPIF))) {
+  }
+  (void)SPDR;                   // Clears SPIF
+}
+
 uint8_t Sodaq_Dataflash::readStatus()
 {
   unsigned char result;
@@ -99,7 +228,7 @@ uint8_t Sodaq_Dataflash::readStatus()
 // Monitor the status register, wait until busy-flag is high
 void Sodaq_Dataflash::waitTillReady()
 {
-  while (!(readStatus() & 0x80)) {
+  while (!(readStatus() & StatusReady)) {
     // WDT reset maybe??
   }
 }
@@ -123,12 +252,51 @@ void Sodaq_Dataflash::readSecurityReg(uint8_t *data, size_t size)
     transmit(0x00);
     transmit(0x00);
     transmit(0x00);
-    for (size_t i = 0; i < size; i++) {
-      *data++ = transmit(0x00);
-    }
+    receiveBlock(data, size);
     deactivate();
 }
 
+/*
+ * Read and write buffer 1 the way it was done before the block transfers
+ *
+ * One transmit() per byte, and digitalWrite() for the slave select. These
+ * are only kept to compare the speed with, see benchmarkDataflash().
+ */
+void Sodaq_Dataflash::readStrBuf1PerByte(uint16_t addr, uint8_t *data, size_t size)
+{
+  waitTransferDone();
+  if (_poweredDown) {
+    resume();
+  }
+  digitalWrite(_ssPin, LOW);
+  transmit(Buf1Read);
+  transmit(0x00);               //don't care
+  transmit((uint8_t) (addr >> 8));
+  transmit((uint8_t) (addr));
+  transmit(0x00);               //don't care
+  for (size_t i = 0; i < size; i++) {
+    *data++ = transmit(0x00);
+  }
+  digitalWrite(_ssPin, HIGH);
+}
+
+void Sodaq_Dataflash::writeStrBuf1PerByte(uint16_t addr, const uint8_t *data, size_t size)
+{
+  waitTransferDone();
+  if (_poweredDown) {
+    resume();
+  }
+  digitalWrite(_ssPin, LOW);
+  transmit(Buf1Write);
+  transmit(0x00);               //don't care
+  transmit((uint8_t) (addr >> 8));
+  transmit((uint8_t) (addr));
+  for (size_t i = 0; i < size; i++) {
+    transmit(*data++);
+  }
+  digitalWrite(_ssPin, HIGH);
+}
+
 // Transfers a page from flash to Dataflash SRAM buffer
 void Sodaq_Dataflash::readPageToBuf1(uint16_t pageAddr)
 {
@@ -165,12 +333,108 @@ void Sodaq_Dataflash::readStrBuf1(uint16_t addr, uint8_t *data, size_t size)
   transmit((uint8_t) (addr >> 8));
   transmit((uint8_t) (addr));
   transmit(0x00);               //don't care
-  for (size_t i = 0; i < size; i++) {
-    *data++ = transmit(0x00);
-  }
+  receiveBlock(data, size);
   deactivate();
 }
 
+/*
+ * Start reading a number of bytes from the Dataflash internal SRAM buffer 1
+ *
+ * The command is sent right away, the data is received in the
+ * background. The buffer must stay valid until isTransferDone().
+ */
+void Sodaq_Dataflash::startReadStrBuf1(uint16_t addr, uint8_t *data, size_t size)
+{
+  if (size == 0) {
+    return;
+  }
+  activate();
+  transmit(Buf1Read);
+  transmit(0x00);               //don't care
+  transmit((uint8_t) (addr >> 8));
+  transmit((uint8_t) (addr));
+  transmit(0x00);               //don't care
+  startBackground(data, size, true);
+}
+
+/*
+ * Start writing a number of bytes to the Dataflash internal SRAM buffer 1
+ *
+ * The buffer must stay valid until isTransferDone().
+ */
+void Sodaq_Dataflash::startWriteStrBuf1(uint16_t addr, const uint8_t *data, size_t size)
+{
+  if (size == 0) {
+    return;
+  }
+  activate();
+  transmit(Buf1Write);
+  transmit(0x00);               //don't care
+  transmit((uint8_t) (addr >> 8));
+  transmit((uint8_t) (addr));
+  startBackground(const_cast<uint8_t *>(data), size, false);
+}
+
+/*
+ * Start the background transfer of the data bytes, SS is active
+ *
+ * An interrupt per byte costs more than the 16 cycles of a byte at
+ * fosc/2, so the background transfer runs at fosc/8 (64 cycles a byte).
+ * Even with the handler inlined the interrupt takes about as long as
+ * that, so the CPU gets little time during the transfer. It only pays
+ * off while the CPU would be waiting anyway, e.g. for the UART.
+ */
+void Sodaq_Dataflash::startBackground(uint8_t *data, size_t size, bool read)
+{
+  _bgRead = read;
+  _bgCount = size;
+  _bgBusy = true;
+  SPCR = _BV(SPIE) | _BV(SPE) | _BV(MSTR) | _BV(SPR0);
+  SPSR = _BV(SPI2X);
+  if (read) {
+    _bgData = data;
+    SPDR = 0;
+  } else {
+    _bgData = data + 1;
+    SPDR = *data;
+  }
+}
+
+/*
+ * Handle the end of the transfer of one byte
+ *
+ * This is inlined in the SPI interrupt. A call from an ISR makes it save
+ * and restore all call-clobbered registers, about 60 cycles per byte.
+ */
+inline void Sodaq_Dataflash::handleSPIInterrupt()
+{
+  uint8_t *data = _bgData;
+  bool read = _bgRead;
+  if (read) {
+    *data++ = SPDR;
+  }
+  if (--_bgCount == 0) {
+    // Back to the synchronous mode
+    SPCR = _BV(SPE) | _BV(MSTR);
+    *_ssPort |= _ssMask;
+    _bgBusy = false;
+    return;
+  }
+  SPDR = read ? 0 : *data++;
+  _bgData = data;
+}
+
+ISR(SPI_STC_vect)
+{
+  dflash.handleSPIInterrupt();
+}
+
+void Sodaq_Dataflash::waitTransferDone()
+{
+  while (_bgBusy) {
+  }
+}
+
 // Writes one byte to one to the Dataflash internal SRAM buffer 1
 void Sodaq_Dataflash::writeByteBuf1(uint16_t addr, uint8_t data)
 {
@@ -191,9 +455,7 @@ void Sodaq_Dataflash::writeStrBuf1(uint16_t addr, uint8_t *data, size_t size)
   transmit(0x00);               //don't care
   transmit((uint8_t) (addr >> 8));
   transmit((uint8_t) (addr));
-  for (size_t i = 0; i < size; i++) {
-    transmit(*data++);
-  }
+  transmitBlock(data, size);
   deactivate();
 }
 
@@ -227,50 +489,85 @@ void Sodaq_Dataflash::chipErase()
   waitTillReady();
 }
 
+/*
+ * Start and end a command, resume from deep power-down if needed
+ */
+void Sodaq_Dataflash::activate()
+{
+  // A background transfer must be finished first
+  waitTransferDone();
+  if (_poweredDown) {
+    resume();
+  }
+  select();
+}
 void Sodaq_Dataflash::deactivate()
 {
-    digitalWrite(_ssPin,HIGH);
+  deselect();
 }
-void Sodaq_Dataflash::activate()
+
+/*
+ * Set the slave select, directly on the port instead of digitalWrite
+ *
+ * Interrupts are blocked for the read-modify-write of the port.
+ */
+void Sodaq_Dataflash::deselect()
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  *_ssPort |= _ssMask;
+  SREG = oldSREG;
+}
+void Sodaq_Dataflash::select()
 {
-    digitalWrite(_ssPin,LOW);
+  uint8_t oldSREG = SREG;
+  cli();
+  *_ssPort &= ~_ssMask;
+  SREG = oldSREG;
 }
 
-void Sodaq_Dataflash::setPageAddr(unsigned int pageAddr)
+void Sodaq_Dataflash::resume()
 {
-  transmit(getPageAddrByte0(pageAddr));
-  transmit(getPageAddrByte1(pageAddr));
-  transmit(getPageAddrByte2(pageAddr));
+  select();
+  transmit(ResumeFromPowerDown);
+  deselect();
+  delayMicroseconds(DF_RESUME_TIME_US);
+  _poweredDown = false;
 }
 
-/*
- * From the AT45DB081D documentation (other variants are not really identical)
- *   "For the DataFlash standard page size (264-bytes), the opcode must be
- *    followed by three address bytes consist of three don’t care bits,
- *    12 page address bits (PA11 - PA0) that specify the page in the main
- *    memory to be written and nine don’t care bits."
- */
-/*
- * From the AT45DB161B documentation
- *   "For the standard DataFlash page size (528 bytes), the opcode must be
- *    followed by three address bytes consist of 2 don’t care bits, 12 page
- *    address bits (PA11 - PA0) that specify the page in the main memory to
- *    be written and 10 don’t care bits."
- */
-uint8_t Sodaq_Dataflash::getPageAddrByte0(uint16_t pageAddr)
+void Sodaq_Dataflash::powerDown()
 {
-  // More correct would be to use a 24 bits number
-  // shift to the left by number of bits. But the uint16_t can be considered
-  // as if it was already shifted by 8.
-  return (pageAddr << (DF_PAGE_BITS - 8)) >> 8;
+  if (_poweredDown) {
+    return;
+  }
+  waitTransferDone();
+  // A program or erase must be finished, otherwise the command is ignored
+  waitTillReady();
+  select();
+  transmit(DeepPowerDown);
+  deselect();
+  _poweredDown = true;
 }
-uint8_t Sodaq_Dataflash::getPageAddrByte1(uint16_t page)
+
+/*
+ * Go to deep power-down if no background transfer is running
+ *
+ * Returns true if the chip is in deep power-down.
+ */
+bool Sodaq_Dataflash::powerDownIfIdle()
 {
-  return page << (DF_PAGE_BITS - 8);
+  if (!_poweredDown && !_bgBusy) {
+    powerDown();
+  }
+  return _poweredDown;
 }
-uint8_t Sodaq_Dataflash::getPageAddrByte2(uint16_t page)
+
+void Sodaq_Dataflash::setPageAddr(unsigned int pageAddr)
 {
-  return 0;
+  uint32_t addr = (uint32_t)pageAddr << _pageAddrShift;
+  transmit(addr >> 16);
+  transmit(addr >> 8);
+  transmit(addr);
 }
 
 // Use a single common instance
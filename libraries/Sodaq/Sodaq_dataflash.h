@@ -23,53 +23,48 @@
 #include <stddef.h>
 #include <stdint.h>
 
-#define DF_AT45DB081D   1
-#define DF_AT45DB161D   2
-
-#define DF_VARIANT      DF_AT45DB161D
-
-#if DF_VARIANT == DF_AT45DB081D
-// configuration for the Atmel AT45DB081D device, Sodaq v2 has AT45DB081D, see doc3596.pdf, 4096 pages of 256/264 bytes
-#define DF_PAGE_ADDR_BITS       12
-#define DF_PAGE_SIZE            264
-#define DF_PAGE_BITS            9
-/*
- * From the AT45DB081D documentation (other variants are not really identical)
- *   "For the DataFlash standard page size (264-bytes), the opcode must be
- *    followed by three address bytes consist of three don’t care bits,
- *    12 page address bits (PA11 - PA0) that specify the page in the main
- *    memory to be written and nine don’t care bits."
- */
-
-#elif DF_VARIANT == DF_AT45DB161D
-// configuration for the Atmel AT45DB161D device
-#define DF_PAGE_ADDR_BITS       12
-#define DF_PAGE_SIZE            528
-#define DF_PAGE_BITS            10
 /*
- * From the AT45DB161B documentation
+ * The geometry of the chip is detected at runtime by init(), from the
+ * device ID. Supported are the AT45DB081D, 161D, 321D and 641D, with the
+ * standard (DataFlash) page size or the binary (power of 2) page size.
+ *
+ * From the AT45DB161D documentation
  *   "For the standard DataFlash page size (528 bytes), the opcode must be
- *    followed by three address bytes consist of 2 don’t care bits, 12 page
+ *    followed by three address bytes consist of 2 don't care bits, 12 page
  *    address bits (PA11 - PA0) that specify the page in the main memory to
- *    be written and 10 don’t care bits."
+ *    be written and 10 don't care bits."
+ * In binary page mode the page address is shifted by 9 instead of 10.
+ * The other variants only differ in the number of bits.
  */
-
-#else
-#error "Unknown DF_VARIANT"
-#endif
-#define DF_NR_PAGES     (1 << DF_PAGE_ADDR_BITS)
+// Time to resume from deep power-down (tRDPD), in microseconds
+#define DF_RESUME_TIME_US       35
 
 class Sodaq_Dataflash
 {
 public:
-  void init(uint8_t misoPin, uint8_t mosiPin, uint8_t sckPin, uint8_t ssPin);
+  bool init(uint8_t misoPin, uint8_t mosiPin, uint8_t sckPin, uint8_t ssPin);
   void readID(uint8_t *data);
+  uint16_t getPageSize() const { return _pageSize; }
+  uint16_t getNrPages() const { return _nrPages; }
+  bool isBinaryPageSize() const { return _binaryPageSize; }
+  void setBinaryPageSize();
   void readSecurityReg(uint8_t *data, size_t size);
 
   uint8_t readByteBuf1(uint16_t pageAddr);
   void readStrBuf1(uint16_t addr, uint8_t *data, size_t size);
   void writeByteBuf1(uint16_t addr, uint8_t data);
   void writeStrBuf1(uint16_t addr, uint8_t *data, size_t size);
+  // The old transfers, a byte at a time. Only a reference for benchmarks.
+  void readStrBuf1PerByte(uint16_t addr, uint8_t *data, size_t size);
+  void writeStrBuf1PerByte(uint16_t addr, const uint8_t *data, size_t size);
+
+  // Transfers in the background, driven by the SPI interrupt
+  void startReadStrBuf1(uint16_t addr, uint8_t *data, size_t size);
+  void startWriteStrBuf1(uint16_t addr, const uint8_t *data, size_t size);
+  bool isTransferDone() const { return !_bgBusy; }
+  void waitTransferDone();
+  // Only for the SPI interrupt, it is inlined there
+  inline void handleSPIInterrupt() __attribute__((always_inline));
 
   void writeBuf1ToPage(uint16_t pageAddr);
   void readPageToBuf1(uint16_t PageAdr);
@@ -77,19 +72,48 @@ public:
   void pageErase(uint16_t pageAddr);
   void chipErase();
 
+  /*
+   * Deep power-down
+   *
+   * powerDownIfIdle() puts the chip in deep power-down, unless a
+   * background transfer is still running. Call it right before the MCU
+   * goes to sleep. The next access resumes the chip.
+   *
+   * There is no idle time to wait for. millis() stops while the MCU is in
+   * power-down, so an idle time would never run out during a sleep.
+   */
+  bool powerDownIfIdle();
+  void powerDown();
+
 private:
   uint8_t readStatus();
   void waitTillReady();
   uint8_t transmit(uint8_t data);
+  void receiveBlock(uint8_t *data, size_t size);
+  void transmitBlock(const uint8_t *data, size_t size);
+  void startBackground(uint8_t *data, size_t size, bool read);
   void activate();
   void deactivate();
+  void select();
+  void deselect();
+  void resume();
   void setPageAddr(unsigned int PageAdr);
-  uint8_t getPageAddrByte0(uint16_t pageAddr);
-  uint8_t getPageAddrByte1(uint16_t pageAddr);
-  uint8_t getPageAddrByte2(uint16_t pageAddr);
+  bool setGeometry();
 
   uint8_t _ssPin;
-  size_t _pageAddrShift;
+  // The port and the bit of the slave select, for direct access
+  volatile uint8_t *_ssPort;
+  uint8_t _ssMask;
+  // The state of the background transfer
+  uint8_t * volatile _bgData;
+  volatile size_t _bgCount;
+  volatile bool _bgRead;
+  volatile bool _bgBusy;
+  uint8_t _pageAddrShift;               // The number of bits of the byte address
+  uint16_t _pageSize;
+  uint16_t _nrPages;
+  bool _binaryPageSize;
+  bool _poweredDown;
 };
 
 extern Sodaq_Dataflash dflash;
@@ -0,0 +1,402 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SIM900Sim.h"
+
+// One byte at 9600 baud, in microseconds
+#define BYTE_TIME_US    1042
+// Waiting for input takes this much time per poll
+#define POLL_TIME_US    100
+// The power pin must be high this long to toggle the power
+#define TOGGLE_TIME_US  1000000
+
+#define TRACE_DIR_RX    0x80
+#define TRACE_CNT_MASK  0x7F
+#define TRACE_HDR_SIZE  3
+
+SIM900Sim *SIM900Sim::_instance;
+
+static bool startsWith(const std::string &line, const char *prefix)
+{
+  return line.compare(0, strlen(prefix), prefix) == 0;
+}
+
+SIM900Sim::SIM900Sim(uint8_t ctsPin, uint8_t powerPin)
+{
+  _instance = this;
+  _ctsPin = ctsPin;
+  _powerPin = powerPin;
+  _powerHigh = 0;
+  _lastOut = 0;
+  _rules = 0;
+  _nrRules = 0;
+  _on = false;
+  _echo = true;
+  _attached = false;
+  _bearer = false;
+  _nitz = false;
+  _httpLength = 0;
+  _ftpDataLeft = 0;
+  _nrErrors = 0;
+  _nrBoots = 0;
+  _nrAttaches = 0;
+  _log = 0;
+  _logLen = 0;
+  _logIx = 0;
+  _logLeft = 0;
+  _logLast = 0;
+  _replaying = false;
+  _mismatch = false;
+  hostSetPin(_ctsPin, LOW);
+  hostSetPinWriteHook(pinWriteHook);
+}
+
+int SIM900Sim::available()
+{
+  int n = 0;
+  for (size_t i = 0; i < _out.size() && _out[i].when <= micros(); ++i) {
+    ++n;
+  }
+  return n;
+}
+
+int SIM900Sim::read()
+{
+  if (_replaying) {
+    replayNext();
+  }
+  if (!_out.empty() && _out.front().when <= micros()) {
+    uint8_t c = _out.front().c;
+    _out.pop_front();
+    return c;
+  }
+  waitForInput();
+  return -1;
+}
+
+int SIM900Sim::peek()
+{
+  if (!_out.empty() && _out.front().when <= micros()) {
+    return _out.front().c;
+  }
+  return -1;
+}
+
+size_t SIM900Sim::write(uint8_t c)
+{
+  hostAdvanceMicros(BYTE_TIME_US);
+  if (_replaying) {
+    replayWrite(c);
+    return 1;
+  }
+  if (!_on) {
+    return 1;
+  }
+  if (_ftpDataLeft > 0) {
+    _ftpData += (char)c;
+    if (--_ftpDataLeft == 0) {
+      sendLines("OK", 200);
+      sendLines("+FTPPUT:1,1,1360", 500);
+    }
+    return 1;
+  }
+  if (_echo) {
+    char echo[2] = { (char)c, '\0' };
+    send(echo, 0);
+  }
+  if (c == '\r') {
+    command(_line);
+    _line.clear();
+  } else if (c != '\n') {
+    _line += (char)c;
+  }
+  return 1;
+}
+
+/*
+ * Rules go before the builtin commands, the first one that matches is used
+ */
+void SIM900Sim::setRules(const Rule *rules, size_t nr)
+{
+  _rules = rules;
+  _nrRules = nr;
+  _ruleUses.assign(nr, 0);
+}
+
+/*
+ * Play back a TraceStream log
+ */
+void SIM900Sim::replay(const uint8_t *log, size_t len)
+{
+  _replaying = true;
+  _log = log;
+  _logLen = len;
+  _logIx = 0;
+  _logLeft = 0;
+  _logLast = micros();
+  _mismatch = false;
+  _out.clear();
+}
+
+void SIM900Sim::waitForInput()
+{
+  hostAdvanceMicros(POLL_TIME_US);
+}
+
+void SIM900Sim::pinWriteHook(uint8_t pin, uint8_t value)
+{
+  if (_instance && pin == _instance->_powerPin) {
+    _instance->powerPin(value);
+  }
+}
+
+/*
+ * A pulse of at least a second on the power pin switches the SIM900 on or off
+ */
+void SIM900Sim::powerPin(uint8_t value)
+{
+  if (value == HIGH) {
+    _powerHigh = micros();
+    return;
+  }
+  if (_powerHigh != 0 && micros() - _powerHigh >= TOGGLE_TIME_US) {
+    if (_on) {
+      switchOff();
+    } else {
+      switchOn();
+    }
+  }
+  _powerHigh = 0;
+}
+
+void SIM900Sim::switchOn()
+{
+  _on = true;
+  _echo = true;
+  _attached = false;
+  _bearer = false;
+  _line.clear();
+  ++_nrBoots;
+  hostSetPin(_ctsPin, HIGH);
+  if (!_replaying) {
+    sendLines("RDY\n+CFUN: 1\n+CPIN: READY", 1000);
+    sendLines("Call Ready", 3000);
+  }
+}
+
+void SIM900Sim::switchOff()
+{
+  if (!_replaying) {
+    sendLines("NORMAL POWER DOWN", 1000);
+  }
+  _on = false;
+  hostSetPin(_ctsPin, LOW);
+}
+
+/*
+ * Queue some text, it starts after the delay or after the text before it
+ */
+void SIM900Sim::send(const char *text, uint32_t delayMs)
+{
+  uint64_t when = micros() + (uint64_t)delayMs * 1000;
+  if (when < _lastOut) {
+    when = _lastOut;
+  }
+  for (const char *ptr = text; *ptr; ++ptr) {
+    when += BYTE_TIME_US;
+    OutByte b = { when, (uint8_t)*ptr };
+    _out.push_back(b);
+  }
+  _lastOut = when;
+}
+
+/*
+ * Queue lines, like the SIM900 does: <CR><LF>text<CR><LF>
+ */
+void SIM900Sim::sendLines(const char *lines, uint32_t delayMs)
+{
+  std::string text;
+  const char *ptr = lines;
+  while (*ptr) {
+    const char *end = strchr(ptr, '\n');
+    size_t len = end ? (size_t)(end - ptr) : strlen(ptr);
+    text += "\r\n";
+    text.append(ptr, len);
+    text += "\r\n";
+    ptr += len;
+    if (*ptr == '\n') {
+      ++ptr;
+    }
+  }
+  send(text.c_str(), delayMs);
+}
+
+void SIM900Sim::command(const std::string &line)
+{
+  if (line.empty()) {
+    return;
+  }
+  for (size_t i = 0; i < _nrRules; ++i) {
+    const Rule *r = &_rules[i];
+    if (startsWith(line, r->command) && (r->count == 0 || _ruleUses[i] < r->count)) {
+      ++_ruleUses[i];
+      sendLines(r->reply, r->delay);
+      if (r->later) {
+        sendLines(r->later, r->laterDelay);
+      }
+      return;
+    }
+  }
+  if (!builtin(line)) {
+    ++_nrErrors;
+    sendLines("ERROR", 10);
+  }
+}
+
+/*
+ * The commands that the SIM900 knows by itself
+ */
+bool SIM900Sim::builtin(const std::string &line)
+{
+  char text[80];
+  if (line == "AT" || line == "AT+CSCLK=0" || line == "AT+CSCLK=2" || line == "AT+CLTS=0") {
+    sendLines("OK", 10);
+  } else if (line == "ATE0") {
+    _echo = false;
+    sendLines("OK", 10);
+  } else if (line == "AT+CLTS=1") {
+    sendLines("OK", 10);
+    if (_nitz) {
+      // The network time comes in when the SIM900 registers
+      sendLines("+CTZV:\"+04\",0\n*PSUTTZ: 2014,11,3,10,15,32,\"+04\",0", 2000);
+    }
+  } else if (line == "AT+CSQ") {
+    sendLines("+CSQ: 18,0\nOK", 20);
+  } else if (line == "AT+CREG?") {
+    sendLines("+CREG: 0,1\nOK", 20);
+  } else if (line == "AT+CGATT?") {
+    sendLines(_attached ? "+CGATT: 1\nOK" : "+CGATT: 0\nOK", 20);
+  } else if (line == "AT+CGATT=1") {
+    _attached = true;
+    ++_nrAttaches;
+    sendLines("OK", 1500);
+  } else if (line == "AT+CCLK?") {
+    sendLines("+CCLK: \"14/11/03,10:15:32+04\"\nOK", 20);
+  } else if (line == "AT+GSN") {
+    sendLines("861234567890123\nOK", 20);
+  } else if (line == "AT+CCID") {
+    sendLines("89310410106543789301\nOK", 20);
+  } else if (startsWith(line, "AT+SAPBR=3,1,")) {
+    sendLines("OK", 10);
+  } else if (line == "AT+SAPBR=1,1") {
+    _bearer = _attached;
+    sendLines(_bearer ? "OK" : "ERROR", 2000);
+  } else if (line == "AT+SAPBR=0,1") {
+    _bearer = false;
+    sendLines("OK", 500);
+  } else if (line == "AT+SAPBR=2,1") {
+    sendLines(_bearer ? "+SAPBR: 1,1,\"10.1.2.3\"\nOK" : "+SAPBR: 1,3,\"0.0.0.0\"\nOK", 20);
+  } else if (line == "AT+HTTPINIT" || line == "AT+HTTPTERM" || startsWith(line, "AT+HTTPPARA=")) {
+    sendLines("OK", 10);
+  } else if (startsWith(line, "AT+HTTPACTION=")) {
+    if (!_bearer) {
+      return false;
+    }
+    _httpLength = _httpData.size();
+    sendLines("OK", 10);
+    snprintf(text, sizeof(text), "+HTTPACTION:0,200,%zu", _httpLength);
+    sendLines(text, 2000);
+  } else if (startsWith(line, "AT+HTTPREAD")) {
+    size_t start = 0;
+    size_t len = _httpLength;
+    if (line.size() > 12 && line[11] == '=') {
+      char *end;
+      start = strtoul(line.c_str() + 12, &end, 10);
+      len = *end == ',' ? strtoul(end + 1, 0, 10) : 0;
+    }
+    if (start > _httpLength) {
+      start = _httpLength;
+    }
+    if (len > _httpLength - start) {
+      len = _httpLength - start;
+    }
+    snprintf(text, sizeof(text), "\r\n+HTTPREAD:%zu\r\n", len);
+    send(text, 50);
+    send(_httpData.substr(start, len).c_str(), 0);
+    send("\r\nOK\r\n", 0);
+  } else if (startsWith(line, "AT+FTPCID=") || startsWith(line, "AT+FTPSERV=")
+      || startsWith(line, "AT+FTPUN=") || startsWith(line, "AT+FTPPW=")
+      || startsWith(line, "AT+FTPPUTNAME=") || startsWith(line, "AT+FTPPUTPATH=")) {
+    sendLines("OK", 10);
+  } else if (line == "AT+FTPPUT=1") {
+    if (!_bearer) {
+      return false;
+    }
+    sendLines("OK", 10);
+    sendLines("+FTPPUT:1,1,1360", 3000);
+  } else if (line == "AT+FTPPUT=2,0") {
+    sendLines("OK", 10);
+    sendLines("+FTPPUT:1,0", 1000);
+  } else if (startsWith(line, "AT+FTPPUT=2,")) {
+    _ftpDataLeft = strtoul(line.c_str() + 12, 0, 10);
+    snprintf(text, sizeof(text), "+FTPPUT:2,%zu", _ftpDataLeft);
+    sendLines(text, 50);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Schedule the received records of the log, up to the next sent record
+ *
+ * The delay of a record is from the start of the record before it.
+ */
+void SIM900Sim::replayNext()
+{
+  while (_logLeft == 0 && _logIx + TRACE_HDR_SIZE <= _logLen) {
+    uint8_t hdr = _log[_logIx];
+    uint16_t dt = _log[_logIx + 1] | (_log[_logIx + 2] << 8);
+    size_t cnt = hdr & TRACE_CNT_MASK;
+    if (!(hdr & TRACE_DIR_RX)) {
+      // Wait for the application to send this
+      _logLeft = cnt;
+      return;
+    }
+    uint64_t when = _logLast + (uint64_t)dt * 1000;
+    if (when < micros()) {
+      when = micros();
+    }
+    _logLast = when;
+    for (size_t i = 0; i < cnt && _logIx + TRACE_HDR_SIZE + i < _logLen; ++i) {
+      OutByte b = { when, _log[_logIx + TRACE_HDR_SIZE + i] };
+      _out.push_back(b);
+    }
+    _logIx += TRACE_HDR_SIZE + cnt;
+  }
+}
+
+/*
+ * The application sends a byte, it must be the next one of the log
+ */
+void SIM900Sim::replayWrite(uint8_t c)
+{
+  replayNext();
+  if (_logLeft == 0) {
+    // Nothing more was sent in the log
+    _mismatch = true;
+    return;
+  }
+  size_t cnt = _log[_logIx] & TRACE_CNT_MASK;
+  size_t pos = cnt - _logLeft;
+  if (pos == 0) {
+    _logLast = micros();
+  }
+  if (_log[_logIx + TRACE_HDR_SIZE + pos] != c) {
+    _mismatch = true;
+  }
+  if (--_logLeft == 0) {
+    _logIx += TRACE_HDR_SIZE + cnt;
+    replayNext();
+  }
+}
@@ -0,0 +1,113 @@
+/*
+ * A simulated SIM900, behind a Stream, for host tests
+ *
+ * There are two modes.
+ *
+ * Scripted: the SIM900 answers the commands it knows. The state that
+ * matters for a session (echo, power, GPRS attach, the bearer) is kept,
+ * and HTTPACTION, HTTPREAD and FTPPUT carry real data. Extra rules can
+ * change the answers, e.g. to make a command fail.
+ *
+ * Replay: the SIM900 plays back a log of a TraceStream. Whatever was
+ * received then is sent now, with the same delays. What is sent to it
+ * must be the same as what was sent then, otherwise it is a mismatch.
+ *
+ * Bytes take the time of the serial line, and waiting for input takes
+ * time too. The host millis() thus tells how long a session takes.
+ */
+#ifndef SIM900SIM_H_
+#define SIM900SIM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+
+class SIM900Sim : public Stream
+{
+public:
+  struct Rule
+  {
+    const char *command;        // The start of the command line
+    const char *reply;          // Lines, separated with '\n'
+    uint16_t delay;             // Milliseconds until the reply
+    const char *later;          // An optional unsolicited reply after that
+    uint16_t laterDelay;
+    uint8_t count;              // It only applies this many times, 0 is always
+  };
+
+  SIM900Sim(uint8_t ctsPin, uint8_t powerPin);
+
+  int available();
+  int read();
+  int peek();
+  void flush() {}
+  size_t write(uint8_t c);
+  using Print::write;
+
+  void setRules(const Rule *rules, size_t nr);
+  void setHTTPData(const std::string &data) { _httpData = data; }
+  void setNITZ(bool x) { _nitz = x; }
+  void replay(const uint8_t *log, size_t len);
+
+  bool isOn() const { return _on; }
+  const std::string &getFTPData() const { return _ftpData; }
+  uint16_t getNrErrors() const { return _nrErrors; }
+  uint16_t getNrBoots() const { return _nrBoots; }
+  uint16_t getNrAttaches() const { return _nrAttaches; }
+  bool isReplayDone() const { return _logIx >= _logLen; }
+  bool isReplayMismatch() const { return _mismatch; }
+
+private:
+  static void pinWriteHook(uint8_t pin, uint8_t value);
+  void powerPin(uint8_t value);
+  void switchOn();
+  void switchOff();
+  void send(const char *text, uint32_t delayMs);
+  void sendLines(const char *lines, uint32_t delayMs);
+  void command(const std::string &line);
+  bool builtin(const std::string &line);
+  void replayWrite(uint8_t c);
+  void replayNext();
+  void waitForInput();
+
+  struct OutByte
+  {
+    uint64_t when;              // In microseconds
+    uint8_t c;
+  };
+  static SIM900Sim *_instance;
+  uint8_t _ctsPin;
+  uint8_t _powerPin;
+  uint64_t _powerHigh;
+  uint64_t _lastOut;
+  std::deque<OutByte> _out;
+  std::string _line;
+  const Rule *_rules;
+  size_t _nrRules;
+  std::vector<uint8_t> _ruleUses;
+  bool _on;
+  bool _echo;
+  bool _attached;
+  bool _bearer;
+  bool _nitz;
+  std::string _httpData;
+  size_t _httpLength;
+  size_t _ftpDataLeft;
+  std::string _ftpData;
+  uint16_t _nrErrors;
+  uint16_t _nrBoots;
+  uint16_t _nrAttaches;
+
+  const uint8_t *_log;
+  size_t _logLen;
+  size_t _logIx;
+  size_t _logLeft;              // Bytes left in the current sent record
+  uint64_t _logLast;            // When the previous record started
+  bool _replaying;
+  bool _mismatch;
+};
+
+#endif /* SIM900SIM_H_ */
@@ -0,0 +1,29 @@
+/*
+ * A minimal check for the host tests
+ */
+#ifndef CHECK_H_
+#define CHECK_H_
+
+#include <stdio.h>
+
+static int nrCheckFailures;
+
+#define CHECK(cond) \
+  do { \
+    if (!(cond)) { \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      ++nrCheckFailures; \
+    } \
+  } while (0)
+
+static inline int checkResult()
+{
+  if (nrCheckFailures != 0) {
+    printf("%d check(s) failed\n", nrCheckFailures);
+    return 1;
+  }
+  printf("All checks passed\n");
+  return 0;
+}
+
+#endif /* CHECK_H_ */
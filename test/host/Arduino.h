@@ -0,0 +1,43 @@
+/*
+ * A minimal Arduino core to build the libraries on the host
+ *
+ * Time is simulated. millis() only advances with delay() and with
+ * hostAdvanceMicros(), e.g. by a simulated device that is waited for.
+ */
+#ifndef HOST_ARDUINO_H_
+#define HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <avr/pgmspace.h>
+#include "WString.h"
+#include "Stream.h"
+
+#define HIGH            1
+#define LOW             0
+#define INPUT           0
+#define OUTPUT          1
+#define INPUT_PULLUP    2
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// Host only
+void hostAdvanceMicros(uint32_t us);
+void hostSetPin(uint8_t pin, int value);
+typedef void (*HostPinWriteHook)(uint8_t pin, uint8_t value);
+void hostSetPinWriteHook(HostPinWriteHook hook);
+
+#endif /* HOST_ARDUINO_H_ */
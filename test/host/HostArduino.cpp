@@ -0,0 +1,108 @@
+#include <stdio.h>
+
+#include "Arduino.h"
+
+#define NR_PINS         32
+
+static uint64_t hostMicros;
+static int pins[NR_PINS];
+static HostPinWriteHook pinWriteHook;
+
+void pinMode(uint8_t, uint8_t)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  if (pin < NR_PINS) {
+    pins[pin] = value;
+  }
+  if (pinWriteHook) {
+    (*pinWriteHook)(pin, value);
+  }
+}
+
+int digitalRead(uint8_t pin)
+{
+  return pin < NR_PINS ? pins[pin] : LOW;
+}
+
+unsigned long millis()
+{
+  return hostMicros / 1000;
+}
+
+unsigned long micros()
+{
+  return hostMicros;
+}
+
+void delay(unsigned long ms)
+{
+  hostMicros += (uint64_t)ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  hostMicros += us;
+}
+
+void hostAdvanceMicros(uint32_t us)
+{
+  hostMicros += us;
+}
+
+void hostSetPin(uint8_t pin, int value)
+{
+  if (pin < NR_PINS) {
+    pins[pin] = value;
+  }
+}
+
+void hostSetPinWriteHook(HostPinWriteHook hook)
+{
+  pinWriteHook = hook;
+}
+
+static char *convert(unsigned long value, bool negative, char *str, int radix)
+{
+  char tmp[34];
+  size_t len = 0;
+  do {
+    int digit = value % radix;
+    tmp[len++] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    value /= radix;
+  } while (value != 0);
+  char *ptr = str;
+  if (negative) {
+    *ptr++ = '-';
+  }
+  while (len > 0) {
+    *ptr++ = tmp[--len];
+  }
+  *ptr = '\0';
+  return str;
+}
+
+char *itoa(int value, char *str, int radix)
+{
+  return ltoa(value, str, radix);
+}
+
+char *utoa(unsigned value, char *str, int radix)
+{
+  return convert(value, false, str, radix);
+}
+
+char *ltoa(long value, char *str, int radix)
+{
+  if (value < 0 && radix == 10) {
+    return convert(-(unsigned long)value, true, str, radix);
+  }
+  return convert((unsigned long)value, false, str, radix);
+}
+
+char *ultoa(unsigned long value, char *str, int radix)
+{
+  return convert(value, false, str, radix);
+}
@@ -0,0 +1,95 @@
+#include "Arduino.h"
+#include "Print.h"
+
+size_t Print::write(const char *str)
+{
+  return write((const uint8_t *)str, strlen(str));
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = 0;
+  while (size-- > 0) {
+    n += write(*buffer++);
+  }
+  return n;
+}
+
+size_t Print::print(const __FlashStringHelper *str)
+{
+  return write(reinterpret_cast<const char *>(str));
+}
+
+size_t Print::print(const String &str)
+{
+  return write(str.c_str());
+}
+
+size_t Print::print(const char str[])
+{
+  return write(str);
+}
+
+size_t Print::print(char c)
+{
+  return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char n, int base)
+{
+  return print((unsigned long)n, base);
+}
+
+size_t Print::print(int n, int base)
+{
+  return print((long)n, base);
+}
+
+size_t Print::print(unsigned int n, int base)
+{
+  return print((unsigned long)n, base);
+}
+
+size_t Print::print(long n, int base)
+{
+  char buf[34];
+  if (base == DEC) {
+    return write(ltoa(n, buf, base));
+  }
+  return write(ultoa((unsigned long)n, buf, base));
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+  char buf[34];
+  ultoa(n, buf, base);
+  if (base == HEX) {
+    // Like the Arduino core, in upper case
+    for (char *ptr = buf; *ptr; ++ptr) {
+      if (*ptr >= 'a') {
+        *ptr -= 'a' - 'A';
+      }
+    }
+  }
+  return write(buf);
+}
+
+size_t Print::println(void)
+{
+  return write("\r\n");
+}
+
+#define PRINTLN(type) \
+  size_t Print::println(type x) { size_t n = print(x); return n + println(); }
+#define PRINTLN_BASE(type) \
+  size_t Print::println(type x, int base) { size_t n = print(x, base); return n + println(); }
+
+PRINTLN(const __FlashStringHelper *)
+PRINTLN(const String &)
+PRINTLN(const char *)
+PRINTLN(char)
+PRINTLN_BASE(unsigned char)
+PRINTLN_BASE(int)
+PRINTLN_BASE(unsigned int)
+PRINTLN_BASE(long)
+PRINTLN_BASE(unsigned long)
@@ -0,0 +1,15 @@
+#ifndef HOST_STREAM_H_
+#define HOST_STREAM_H_
+
+#include "Print.h"
+
+class Stream : public Print
+{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush() = 0;
+};
+
+#endif /* HOST_STREAM_H_ */
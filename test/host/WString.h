@@ -0,0 +1,19 @@
+#ifndef HOST_WSTRING_H_
+#define HOST_WSTRING_H_
+
+#include <string>
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(PSTR(s)))
+
+class String
+{
+public:
+  String(const char *s = "") : _str(s) {}
+  unsigned int length() const { return _str.length(); }
+  const char *c_str() const { return _str.c_str(); }
+private:
+  std::string _str;
+};
+
+#endif /* HOST_WSTRING_H_ */
@@ -0,0 +1,24 @@
+/*
+ * There is no I2C on the host. The transfers do nothing, reads give 0.
+ */
+#ifndef HOST_WIRE_H_
+#define HOST_WIRE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+class TwoWire
+{
+public:
+  void begin() {}
+  void beginTransmission(uint8_t) {}
+  uint8_t endTransmission() { return 0; }
+  size_t write(uint8_t) { return 1; }
+  uint8_t requestFrom(uint8_t, uint8_t) { return 0; }
+  int available() { return 0; }
+  int read() { return 0; }
+};
+
+extern TwoWire Wire;
+
+#endif /* HOST_WIRE_H_ */
@@ -0,0 +1,23 @@
+#ifndef HOST_PGMSPACE_H_
+#define HOST_PGMSPACE_H_
+
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+
+#define PROGMEM
+#define PGM_P                   const char *
+#define PSTR(s)                 ((const char *)(s))
+#define pgm_read_byte(a)        (*(const uint8_t *)(a))
+#define pgm_read_byte_near(a)   (*(const uint8_t *)(a))
+#define pgm_read_word(a)        (*(const uint16_t *)(a))
+#define pgm_read_dword(a)       (*(const uint32_t *)(a))
+#define strcpy_P                strcpy
+#define strncpy_P               strncpy
+#define strcat_P                strcat
+#define strcmp_P                strcmp
+#define strncmp_P               strncmp
+#define strlen_P                strlen
+#define memcpy_P                memcpy
+
+#endif /* HOST_PGMSPACE_H_ */
@@ -0,0 +1,6 @@
+#ifndef HOST_WDT_H_
+#define HOST_WDT_H_
+
+#define wdt_reset()
+
+#endif /* HOST_WDT_H_ */
@@ -0,0 +1,14 @@
+/*
+ * The avr-libc stdlib.h also has the integer to string conversions
+ */
+#ifndef HOST_STDLIB_H_
+#define HOST_STDLIB_H_
+
+#include_next <stdlib.h>
+
+char *itoa(int value, char *str, int radix);
+char *utoa(unsigned value, char *str, int radix);
+char *ltoa(long value, char *str, int radix);
+char *ultoa(unsigned long value, char *str, int radix);
+
+#endif /* HOST_STDLIB_H_ */
@@ -0,0 +1,12 @@
+/*
+ * The busy waits of avr-libc, on the simulated clock
+ */
+#ifndef HOST_UTIL_DELAY_H_
+#define HOST_UTIL_DELAY_H_
+
+#include <Arduino.h>
+
+#define _delay_ms(ms)   delay(ms)
+#define _delay_us(us)   delayMicroseconds(us)
+
+#endif /* HOST_UTIL_DELAY_H_ */
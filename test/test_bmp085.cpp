@@ -0,0 +1,29 @@
+/*
+ * The BMP085 temperature compensation (B5) of the pressure
+ */
+#include <stdio.h>
+
+#include <Sodaq_BMP085.h>
+
+#include "check.h"
+
+static void testNoB5()
+{
+  Sodaq_BMP085 bmp;
+  int16_t temperature = 123;
+  uint16_t pressure = 456;
+  // No temperature conversion was done yet, there is nothing to reuse
+  CHECK(!bmp.calcTemperaturePressureX10(0, 40000, &temperature, &pressure));
+  CHECK(temperature == 123 && pressure == 456);
+
+  float temp = 1.5;
+  int32_t pres = 789;
+  CHECK(!bmp.calcTemperaturePressure(0, 40000, &temp, &pres));
+  CHECK(temp == 1.5 && pres == 789);
+}
+
+int main()
+{
+  testNoB5();
+  return checkResult();
+}
@@ -0,0 +1,138 @@
+/*
+ * The DateTime conversions compared with gmtime(), and timed against the
+ * loops they replaced
+ *
+ * The timing is done on the host, so it only shows the ratio. The number
+ * of loop steps of the old code is shown as well: up to 99 years and 11
+ * months, each with a few 8 and 16 bit operations on the AVR.
+ */
+#include <stdio.h>
+#include <time.h>
+#include <chrono>
+
+#include <Sodaq_DS3231.h>
+
+#include "check.h"
+
+#define EPOCH_TIME_OFF  946684800L      // 2000-01-01 00:00:00
+#define SECONDS_PER_DAY 86400L
+#define NR_DAYS         36525           // 2000-01-01 .. 2099-12-31
+
+/*
+ * The old conversions, before they were made constant time
+ */
+static const uint8_t daysInMonth [] = { 31,28,31,30,31,30,31,31,30,31,30,31 };
+
+static unsigned long oldSteps;
+
+static uint16_t oldDate2days(uint16_t y, uint8_t m, uint8_t d) {
+    if (y >= 2000)
+        y -= 2000;
+    uint16_t days = d;
+    for (uint8_t i = 1; i < m; ++i) {
+        days += daysInMonth[i - 1];
+        ++oldSteps;
+    }
+    if (m > 2 && y % 4 == 0)
+        ++days;
+    return days + 365 * y + (y + 3) / 4 - 1;
+}
+
+static void oldDays2date(uint16_t days, uint8_t *yOff, uint8_t *m, uint8_t *d) {
+    uint8_t leap;
+    for (*yOff = 0; ; ++*yOff) {
+        ++oldSteps;
+        leap = *yOff % 4 == 0;
+        if (days < 365 + leap)
+            break;
+        days -= 365 + leap;
+    }
+    for (*m = 1; ; ++*m) {
+        ++oldSteps;
+        uint8_t daysPerMonth = daysInMonth[*m - 1];
+        if (leap && *m == 2)
+            ++daysPerMonth;
+        if (days < daysPerMonth)
+            break;
+        days -= daysPerMonth;
+    }
+    *d = days + 1;
+}
+
+static void testAllDays()
+{
+  static const long times[] = { 0, 12L * 3600 + 34 * 60 + 56, SECONDS_PER_DAY - 1 };
+  for (long day = 0; day < NR_DAYS; ++day) {
+    for (size_t i = 0; i < sizeof(times) / sizeof(times[0]); ++i) {
+      long t = day * SECONDS_PER_DAY + times[i];
+      time_t epoch = t + EPOCH_TIME_OFF;
+      struct tm tm;
+      gmtime_r(&epoch, &tm);
+
+      DateTime dt(t);
+      bool ok = dt.year() == tm.tm_year + 1900
+          && dt.month() == tm.tm_mon + 1
+          && dt.date() == tm.tm_mday
+          && dt.hour() == tm.tm_hour
+          && dt.minute() == tm.tm_min
+          && dt.second() == tm.tm_sec
+          && dt.dayOfWeek() == tm.tm_wday + 1
+          && dt.get() == (uint32_t)t
+          && dt.getEpoch() == (uint32_t)epoch;
+      if (!ok) {
+        printf("Day %ld: %04d-%02d-%02d wday %d, gmtime %04d-%02d-%02d wday %d\n", day,
+            dt.year(), dt.month(), dt.date(), dt.dayOfWeek(),
+            tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_wday + 1);
+      }
+      CHECK(ok);
+
+      DateTime dt2(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+          tm.tm_hour, tm.tm_min, tm.tm_sec, tm.tm_wday + 1);
+      CHECK(dt2.get() == (uint32_t)t);
+    }
+  }
+}
+
+static void testCompileTime()
+{
+  DateTime dt("Oct 19 2026", "06:42:25");
+  CHECK(dt.year() == 2026 && dt.month() == 10 && dt.date() == 19);
+  CHECK(dt.dayOfWeek() == 2);           // Monday
+}
+
+/*
+ * Compare the speed of the new and the old conversions, over all days
+ */
+static void benchmark()
+{
+  typedef std::chrono::steady_clock Clock;
+  volatile uint32_t sink = 0;
+
+  Clock::time_point start = Clock::now();
+  for (long day = 0; day < NR_DAYS; ++day) {
+    DateTime dt(day * SECONDS_PER_DAY);
+    sink += dt.get();
+  }
+  double newNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+  oldSteps = 0;
+  start = Clock::now();
+  for (long day = 0; day < NR_DAYS; ++day) {
+    uint8_t yOff, m, d;
+    oldDays2date(day, &yOff, &m, &d);
+    sink += oldDate2days(yOff, m, d);
+  }
+  double oldNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+  printf("Days to date and back, per day: new %.1f ns, old %.1f ns (%.1f loop steps)\n",
+      newNs / NR_DAYS, oldNs / NR_DAYS, (double)oldSteps / NR_DAYS);
+  (void)sink;
+}
+
+int main()
+{
+  testAllDays();
+  testCompileTime();
+  benchmark();
+  return checkResult();
+}
@@ -0,0 +1,302 @@
+/*
+ * Sessions of the GPRSbee with a simulated SIM900
+ *
+ * Each session is checked, and its time, bytes and commands are shown, so
+ * that changes to the GPRSbee can be compared. The first session is also
+ * recorded and then replayed.
+ */
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include <GPRSbee.h>
+#include <Sodaq_TraceStream.h>
+
+#include "SIM900Sim.h"
+#include "check.h"
+
+#define CTS_PIN         20
+#define POWER_PIN       21
+#define APN             "internet"
+#define URL             "http://time.sodaq.net/"
+
+static uint8_t traceBuffer[16384];
+
+static void showStats(const char *name, TraceStream &trace)
+{
+  printf("%-28s ms=%-6lu sent=%-5lu received=%-5lu commands=%u\n", name,
+      (unsigned long)trace.getElapsed(), (unsigned long)trace.getNrSent(),
+      (unsigned long)trace.getNrReceived(), trace.getNrCommands());
+}
+
+static std::vector<uint8_t> recordedLog;
+static uint32_t recordedMs;
+
+static void testHTTPGET()
+{
+  SIM900Sim sim(CTS_PIN, POWER_PIN);
+  sim.setHTTPData("1415009732");
+  TraceStream trace(sim, traceBuffer, sizeof(traceBuffer));
+  gprsbee.init(trace, CTS_PIN, POWER_PIN);
+
+  char buffer[20];
+  CHECK(gprsbee.doHTTPGET(APN, URL, buffer, sizeof(buffer)));
+  CHECK(strcmp(buffer, "1415009732") == 0);
+  CHECK(!sim.isOn());
+  CHECK(sim.getNrErrors() == 0);
+  CHECK(!trace.isOverflow());
+  showStats("HTTP GET", trace);
+
+  recordedLog.assign(trace.getLog(), trace.getLog() + trace.getLogLength());
+  recordedMs = trace.getElapsed();
+}
+
+static void testReplay()
+{
+  SIM900Sim sim(CTS_PIN, POWER_PIN);
+  sim.replay(recordedLog.data(), recordedLog.size());
+  TraceStream trace(sim, traceBuffer, sizeof(traceBuffer));
+  gprsbee.init(trace, CTS_PIN, POWER_PIN);
+
+  char buffer[20];
+  CHECK(gprsbee.doHTTPGET(APN, URL, buffer, sizeof(buffer)));
+  CHECK(strcmp(buffer, "1415009732") == 0);
+  CHECK(!sim.isReplayMismatch());
+  CHECK(sim.isReplayDone());
+  // The replay takes about as long as the recording
+  CHECK(trace.getElapsed() * 10 >= recordedMs * 9 && trace.getElapsed() * 10 <= recordedMs * 11);
+  showStats("HTTP GET, replayed", trace);
+}
+
+static void testSleepMode()
+{
+  SIM900Sim sim(CTS_PIN, POWER_PIN);
+  sim.setHTTPData("1415009732");
+  TraceStream trace(sim, traceBuffer, sizeof(traceBuffer));
+  gprsbee.init(trace, CTS_PIN, POWER_PIN);
+  gprsbee.setSleepMode(true);
+
+  char buffer[20];
+  CHECK(gprsbee.doHTTPGET(APN, URL, buffer, sizeof(buffer)));
+  CHECK(sim.isOn() && gprsbee.isSleeping());
+  uint32_t firstMs = trace.getElapsed();
+  uint16_t firstCommands = trace.getNrCommands();
+  showStats("HTTP GET, boot", trace);
+
+  // Still attached, with the bearer open. No boot and no full setup.
+  trace.clear();
+  CHECK(gprsbee.doHTTPGET(APN, URL, buffer, sizeof(buffer)));
+  CHECK(strcmp(buffer, "1415009732") == 0);
+  CHECK(sim.getNrBoots() == 1);
+  CHECK(trace.getNrCommands() < firstCommands);
+  CHECK(trace.getElapsed() < firstMs);
+  showStats("HTTP GET, after sleep", trace);
+}
+
+static std::string sinkData;
+static size_t sinkCalls;
+static size_t sinkStopAfter;
+static bool sinkSawNetworkTime;
+
+static bool sink(const uint8_t *data, size_t len)
+{
+  sinkData.append((const char *)data, len);
+  ++sinkCalls;
+  sinkSawNetworkTime = gprsbee.isNetworkTimeFresh();
+  // A slow sink, e.g. writing to dataflash. Nothing may get lost.
+  delay(200);
+  return sinkStopAfter == 0 || sinkCalls < sinkStopAfter;
+}
+
+static void testSink()
+{
+  std::string body;
+  for (int i = 0; body.size() < 1500; ++i) {
+    body += std::to_string(i);
+    body += ',';
+  }
+  SIM900Sim sim(CTS_PIN, POWER_PIN);
+  sim.setHTTPData(body);
+  TraceStream trace(sim, traceBuffer, sizeof(traceBuffer));
+  gprsbee.init(trace, CTS_PIN, POWER_PIN);
+
+  uint8_t buffer[512];
+  sinkData.clear();
+  sinkCalls = 0;
+  sinkStopAfter = 0;
+  CHECK(gprsbee.doHTTPGET(APN, URL, sink, buffer, sizeof(buffer)));
+  CHECK(!gprsbee.isHTTPREADstopped());
+  CHECK(sinkData == body);
+  CHECK(sinkCalls == (body.size() + sizeof(buffer) - 1) / sizeof(buffer));
+  showStats("HTTP GET, sink", trace);
+
+  // The sink stops after the first range. That is not a failure.
+  sinkData.clear();
+  sinkCalls = 0;
+  sinkStopAfter = 1;
+  CHECK(gprsbee.doHTTPGET(APN, URL, sink, buffer, sizeof(buffer)));
+  CHECK(gprsbee.isHTTPREADstopped());
+  CHECK(sinkData == body.substr(0, sizeof(buffer)));
+
+  // Without a buffer nothing can be read, it must not hang
+  sinkData.clear();
+  sinkStopAfter = 0;
+  CHECK(!gprsbee.doHTTPGET(APN, URL, sink, buffer, 0));
+  CHECK(sinkData.empty());
+}
+
+static void testNetworkTime()
+{
+  SIM900Sim sim(CTS_PIN, POWER_PIN);
+  sim.setHTTPData("x");
+  sim.setNITZ(true);
+  TraceStream trace(sim, traceBuffer, sizeof(traceBuffer));
+  gprsbee.init(trace, CTS_PIN, POWER_PIN);
+  gprsbee.setLTSMode(true);
+  gprsbee.setSleepMode(true);
+
+  uint8_t buffer[16];
+  sinkStopAfter = 0;
+  CHECK(gprsbee.doHTTPGET(APN, URL, sink, buffer, sizeof(buffer)));
+  CHECK(sinkSawNetworkTime);
+  CHECK(!gprsbee.isNetworkTimeFresh());
+
+  // After the sleep there is no new network time
+  CHECK(gprsbee.doHTTPGET(APN, URL, sink, buffer, sizeof(buffer)));
+  CHECK(!sinkSawNetworkTime);
+}
+
+static void testFTP()
+{
+  std::string data;
+  for (int i = 0; data.size() < 3000; ++i) {
+    data += "1415009732,21.5,45.0,1013.2,4012\r\n";
+  }
+  SIM900Sim sim(CTS_PIN, POWER_PIN);
+  TraceStream trace(sim, traceBuffer, sizeof(traceBuffer));
+  gprsbee.init(trace, CTS_PIN, POWER_PIN);
+
+  CHECK(gprsbee.openFTP(APN, "ftp.example.com", "user", "secret"));
+  CHECK(gprsbee.openFTPfile("test.csv", "/"));
+  CHECK(gprsbee.sendFTPdata((uint8_t *)&data[0], data.size()));
+  CHECK(gprsbee.closeFTPfile());
+  CHECK(gprsbee.closeFTP());
+  CHECK(sim.getFTPData() == data);
+  CHECK(!sim.isOn());
+  showStats("FTP upload", trace);
+}
+
+/*
+ * One HTTP GET with some rules. It must fail, in a limited time, and
+ * leave the SIM900 switched off.
+ */
+static void checkFailure(const char *name, const SIM900Sim::Rule *rules, size_t nr,
+    uint32_t maxMs)
+{
+  SIM900Sim sim(CTS_PIN, POWER_PIN);
+  sim.setHTTPData("1415009732");
+  sim.setRules(rules, nr);
+  TraceStream trace(sim, traceBuffer, sizeof(traceBuffer));
+  gprsbee.init(trace, CTS_PIN, POWER_PIN);
+
+  char buffer[20];
+  CHECK(!gprsbee.doHTTPGET(APN, URL, buffer, sizeof(buffer)));
+  CHECK(!sim.isOn());
+  CHECK(trace.getElapsed() <= maxMs);
+  showStats(name, trace);
+}
+
+static void testErrors()
+{
+  static const SIM900Sim::Rule noAttach[] = {
+    { "AT+CGATT=1", "ERROR", 1000 },
+  };
+  checkFailure("CGATT fails", noAttach, 1, 120000);
+
+  static const SIM900Sim::Rule noBearer[] = {
+    { "AT+SAPBR=1,1", "ERROR", 2000 },
+  };
+  checkFailure("SAPBR fails", noBearer, 1, 90000);
+
+  static const SIM900Sim::Rule serverError[] = {
+    { "AT+HTTPACTION=", "OK", 10, "+HTTPACTION:0,601,0", 2000 },
+  };
+  checkFailure("HTTPACTION 601", serverError, 1, 30000);
+
+  // The data stops halfway, and there is no OK
+  static const SIM900Sim::Rule shortRead[] = {
+    { "AT+HTTPREAD", "+HTTPREAD:10\n14150", 50 },
+  };
+  checkFailure("HTTPREAD times out", shortRead, 1, 30000);
+}
+
+/*
+ * The bearer only opens at the third try, that is still a success
+ */
+static void testBearerRetry()
+{
+  static const SIM900Sim::Rule rules[] = {
+    { "AT+SAPBR=1,1", "ERROR", 2000, 0, 0, 2 },
+  };
+  SIM900Sim sim(CTS_PIN, POWER_PIN);
+  sim.setHTTPData("1415009732");
+  sim.setRules(rules, 1);
+  TraceStream trace(sim, traceBuffer, sizeof(traceBuffer));
+  gprsbee.init(trace, CTS_PIN, POWER_PIN);
+
+  char buffer[20];
+  CHECK(gprsbee.doHTTPGET(APN, URL, buffer, sizeof(buffer)));
+  CHECK(strcmp(buffer, "1415009732") == 0);
+  showStats("SAPBR fails twice", trace);
+}
+
+/*
+ * An upload fails with the SIM900 in sleep mode. The retry must find it
+ * asleep and still registered, without a boot or a new GPRS attach.
+ */
+static void testUploadRetry()
+{
+  static const SIM900Sim::Rule rules[] = {
+    // Net error, only the first time
+    { "AT+FTPPUT=1", "OK", 10, "+FTPPUT:1,61", 3000, 1 },
+  };
+  std::string data = "1415009732,21.5,45.0,1013.2,4012\r\n";
+  SIM900Sim sim(CTS_PIN, POWER_PIN);
+  sim.setRules(rules, 1);
+  TraceStream trace(sim, traceBuffer, sizeof(traceBuffer));
+  gprsbee.init(trace, CTS_PIN, POWER_PIN);
+  gprsbee.setSleepMode(true);
+
+  CHECK(gprsbee.openFTP(APN, "ftp.example.com", "user", "secret"));
+  CHECK(!gprsbee.openFTPfile("test.csv", "/"));
+  CHECK(gprsbee.closeFTP());
+  CHECK(sim.isOn() && gprsbee.isSleeping());
+  uint32_t firstMs = trace.getElapsed();
+  showStats("FTP upload, fails", trace);
+
+  trace.clear();
+  CHECK(gprsbee.openFTP(APN, "ftp.example.com", "user", "secret"));
+  CHECK(gprsbee.openFTPfile("test.csv", "/"));
+  CHECK(gprsbee.sendFTPdata((uint8_t *)&data[0], data.size()));
+  CHECK(gprsbee.closeFTPfile());
+  CHECK(gprsbee.closeFTP());
+  CHECK(sim.getFTPData() == data);
+  CHECK(sim.getNrBoots() == 1);
+  CHECK(sim.getNrAttaches() == 1);
+  CHECK(trace.getElapsed() < firstMs);
+  showStats("FTP upload, retry", trace);
+}
+
+int main()
+{
+  testHTTPGET();
+  testReplay();
+  testSleepMode();
+  testSink();
+  testNetworkTime();
+  testFTP();
+  testErrors();
+  testBearerRetry();
+  testUploadRetry();
+  return checkResult();
+}
@@ -0,0 +1,176 @@
+/*
+ * RTCTimer events: handles, one-shot events, context callbacks, and
+ * a callback that sets the clock
+ */
+#include <stdio.h>
+
+#include <RTCTimer.h>
+
+#include "check.h"
+
+static RTCTimer timer;
+static uint32_t clockNow;
+static int nrSyncs;
+static int nrUploads;
+
+static uint32_t getNow()
+{
+  return clockNow;
+}
+
+// The clock was 1000 seconds ahead
+static void syncClock(uint32_t now)
+{
+  (void)now;
+  uint32_t old = clockNow;
+  clockNow -= 1000;
+  timer.adjust(old, clockNow);
+  ++nrSyncs;
+}
+
+static void upload(uint32_t now)
+{
+  (void)now;
+  ++nrUploads;
+}
+
+static void testAdjustInCallback()
+{
+  clockNow = 10000;
+  timer.setNowCallback(getNow);
+  timer.every(60, syncClock, 1);
+  timer.every(600, upload);
+
+  clockNow = 10060;
+  timer.update();
+  CHECK(nrSyncs == 1);
+  // The upload is now due at 9600, the clock says 9060
+  CHECK(nrUploads == 0);
+  CHECK(timer.getSecondsUntilNextEvent(clockNow) == 540);
+
+  clockNow = 9600;
+  timer.update();
+  CHECK(nrUploads == 1);
+}
+
+static int nrTicks;
+static uint32_t lastTick;
+
+static void tick(uint32_t now)
+{
+  ++nrTicks;
+  lastTick = now;
+}
+
+static void countInContext(uint32_t now, void *context)
+{
+  (void)now;
+  ++*(int *)context;
+}
+
+/*
+ * A handle of a finished event must not reach a new event in its slot
+ */
+static void testStaleHandle()
+{
+  static RTCTimer t;
+  RTCEventHandle first = t.at(100, tick);
+  CHECK(first >= 0 && t.isActive(first));
+  t.update(100);
+  CHECK(nrTicks == 1 && !t.isActive(first));
+
+  RTCEventHandle second = t.at(200, tick);
+  CHECK(second >= 0 && second != first);
+  CHECK((second & 0xFF) == (first & 0xFF));
+  CHECK(!t.cancel(first));
+  CHECK(!t.reschedule(first, 150));
+  CHECK(t.isActive(second));
+  t.update(200);
+  CHECK(nrTicks == 2 && lastTick == 200);
+  nrTicks = 0;
+}
+
+static void testCancel()
+{
+  static RTCTimer t;
+  RTCEventHandle h = t.every(10, tick);
+  t.update(10);
+  CHECK(nrTicks == 1);
+  CHECK(t.cancel(h));
+  CHECK(!t.isActive(h) && !t.hasEvents());
+  CHECK(!t.cancel(h));
+  t.update(20);
+  CHECK(nrTicks == 1);
+  nrTicks = 0;
+}
+
+static void testReschedule()
+{
+  static RTCTimer t;
+  RTCEventHandle h = t.every(100, tick);
+  CHECK(t.reschedule(h, 30));
+  CHECK(t.getNextEventTime() == 30);
+  t.update(29);
+  CHECK(nrTicks == 0);
+  t.update(30);
+  CHECK(nrTicks == 1 && lastTick == 30);
+  // Periodic from the new time on
+  t.update(129);
+  CHECK(nrTicks == 1);
+  t.update(130);
+  CHECK(nrTicks == 2);
+  t.cancel(h);
+  nrTicks = 0;
+}
+
+/*
+ * A second at() of the same callback moves the existing event to the
+ * earliest time, it does not add one
+ */
+static void testAtCoalescing()
+{
+  static RTCTimer t;
+  RTCEventHandle h1 = t.at(500, tick);
+  RTCEventHandle h2 = t.at(300, tick);
+  RTCEventHandle h3 = t.at(400, tick);
+  CHECK(h1 == h2 && h2 == h3);
+  CHECK(t.getNextEventTime() == 300);
+
+  // A different context is a different event
+  int a = 0;
+  int b = 0;
+  RTCEventHandle ha = t.at(300, countInContext, &a);
+  RTCEventHandle hb = t.at(300, countInContext, &b);
+  CHECK(ha >= 0 && hb >= 0 && ha != hb && ha != h1);
+  CHECK(t.at(200, countInContext, &a) == ha);
+
+  t.update(300);
+  CHECK(nrTicks == 1 && lastTick == 300);
+  CHECK(a == 1 && b == 1);
+  CHECK(!t.hasEvents());
+  nrTicks = 0;
+}
+
+static void testContextCallback()
+{
+  static RTCTimer t;
+  int counts[2] = { 0, 0 };
+  t.every(10, countInContext, &counts[0], 3);
+  t.every(20, countInContext, &counts[1]);
+  for (uint32_t now = 10; now <= 100; now += 10) {
+    t.update(now);
+  }
+  CHECK(counts[0] == 3);
+  CHECK(counts[1] == 5);
+}
+
+int main()
+{
+  testAdjustInCallback();
+  testStaleHandle();
+  testCancel();
+  testReschedule();
+  testAtCoalescing();
+  testContextCallback();
+  return checkResult();
+}
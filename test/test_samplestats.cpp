@@ -0,0 +1,63 @@
+/*
+ * The statistics of the samples of one channel
+ */
+#include <stdio.h>
+#include <math.h>
+
+#include <SampleStats.h>
+
+#include "check.h"
+
+static void testNormal()
+{
+  SampleStats stats;
+  stats.clear();
+  static const int16_t values[] = { 215, 217, 219, 221, 223 };
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+    stats.add(values[i]);
+  }
+  CHECK(stats.getCount() == 5);
+  CHECK(stats.getMin() == 215 && stats.getMax() == 223);
+  CHECK(stats.getMean() == 219);
+  CHECK(stats.getStdDev() == 2);        // sqrt(8) rounded down
+}
+
+/*
+ * An outlier far beyond the limit of the sums, e.g. a sensor that failed
+ */
+static void testOutlier()
+{
+  SampleStats stats;
+  stats.clear();
+  for (int i = 0; i < 254; ++i) {
+    stats.add(10000);
+  }
+  stats.add(-20000);
+  CHECK(stats.getCount() == 255);
+  CHECK(stats.getMin() == -20000 && stats.getMax() == 10000);
+  // The outlier counts as 10000 - 4095
+  double mean = 10000 - 4095.0 / 255;
+  double var = 254.0 / 255 * 4095.0 * 4095.0 / 255;
+  CHECK(abs(stats.getMean() - (int)round(mean)) <= 1);
+  CHECK(abs(stats.getStdDev() - (int)sqrt(var)) <= 1);
+}
+
+static void testManyLarge()
+{
+  SampleStats stats;
+  stats.clear();
+  for (int i = 0; i < 255; ++i) {
+    stats.add(i % 2 ? 32767 : -32768);
+  }
+  // Must not overflow
+  CHECK(stats.getStdDev() <= 4095);
+  CHECK(stats.getStdDev() >= 2000);
+}
+
+int main()
+{
+  testNormal();
+  testOutlier();
+  testManyLarge();
+  return checkResult();
+}
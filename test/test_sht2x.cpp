@@ -0,0 +1,96 @@
+/*
+ * The integer SHT21 conversions compared with the float ones
+ *
+ * The integer result is the exact truncation of the formula. The float
+ * result has rounding errors, so its truncation can be one less, e.g.
+ * raw 26424 is 24.0 Deg C with float, and 23.9 with the integer version.
+ * A difference of at most 1 (0.1 Deg C or 0.1 %RH) is accepted.
+ *
+ * On the AVR a double is a float. On the host the library functions
+ * calculate with double, so the same formulas are also done here in float.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Sodaq_SHT2x.h>
+
+#include "check.h"
+
+#define TOLERANCE       1
+
+static float avrTemperature(uint16_t raw)
+{
+  return -46.85f + 175.72f / 65536.0f * raw;
+}
+
+static float avrHumidity(uint16_t raw)
+{
+  return -6.0f + 125.0f / 65536.0f * raw;
+}
+
+static bool isClose(int x10, int ref)
+{
+  return abs(x10 - ref) <= TOLERANCE;
+}
+
+static void testTemperature()
+{
+  long nrDiffs = 0;
+  for (long raw = 0; raw <= 0xFFFF; ++raw) {
+    int16_t x10 = SHT2xClass::calcTemperatureX10(raw);
+    int16_t ref = SHT2xClass::calcTemperature(raw) * 10;
+    if (raw == 0) {
+      CHECK(x10 == -2730);
+      continue;
+    }
+    int16_t avr = avrTemperature(raw) * 10;
+    if (!isClose(x10, ref) || !isClose(x10, avr)) {
+      printf("Temperature raw %ld: %d, float %d %d\n", raw, x10, ref, avr);
+      CHECK(isClose(x10, ref) && isClose(x10, avr));
+    }
+    if (x10 != ref) {
+      ++nrDiffs;
+    }
+    // The exact truncation of T * 10 = (17572 * raw - 4685 * 2^16) / (10 * 2^16)
+    int64_t num = 17572LL * raw - 4685LL * 65536;
+    int64_t den = 10LL * 65536;
+    CHECK((int64_t)x10 * den <= num || num < 0);
+    CHECK(((int64_t)x10 + 1) * den > num || num < 0);
+  }
+  printf("Temperature: %ld of 65535 values differ by 1 from double\n", nrDiffs);
+}
+
+static void testHumidity()
+{
+  long nrDiffs = 0;
+  for (long raw = 0; raw <= 0xFFFF; ++raw) {
+    int x10 = SHT2xClass::calcHumidityX10(raw);
+    int ref = SHT2xClass::calcHumidity(raw) * 10;
+    int avr = avrHumidity(raw) * 10;
+    // The integer version gives 0 for the negative values
+    if (ref < 0) {
+      ref = 0;
+    }
+    if (avr < 0) {
+      avr = 0;
+    }
+    if (!isClose(x10, ref) || !isClose(x10, avr)) {
+      printf("Humidity raw %ld: %d, float %d %d\n", raw, x10, ref, avr);
+      CHECK(isClose(x10, ref) && isClose(x10, avr));
+    }
+    if (x10 != ref) {
+      ++nrDiffs;
+    }
+  }
+  printf("Humidity: %ld of 65535 values differ by 1 from double\n", nrDiffs);
+}
+
+int main()
+{
+  CHECK(SHT2xClass::calcTemperatureX10(26424) == 239);
+  CHECK(SHT2xClass::calcTemperatureX10(54172) == 983);
+  CHECK(SHT2xClass::calcHumidityX10(54172) == 973);
+  testTemperature();
+  testHumidity();
+  return checkResult();
+}
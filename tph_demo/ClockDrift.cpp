@@ -0,0 +1,121 @@
+#include <Arduino.h>
+#include <Sodaq_DS3231.h>
+
+#include "ClockDrift.h"
+#include "SQ_Diag.h"
+
+/*
+ * The offsets are kept as if the RTC was never corrected, by adding
+ * all the corrections. Only the difference with the reference matters.
+ */
+static bool haveReference;
+static uint32_t refTs;
+static int32_t refOffset;
+static uint8_t refUncertainty;
+static int32_t corrections;
+// The sync interval that keeps the error below CLOCK_MAX_ERROR, 0 if unknown
+static uint32_t syncInterval;
+
+static void setReference(uint32_t ts, int32_t offset, uint8_t uncertainty)
+{
+  haveReference = true;
+  refTs = ts;
+  refOffset = offset;
+  refUncertainty = uncertainty;
+  syncInterval = 0;
+}
+
+/*
+ * Change the aging offset of the DS3231 for a drift (in 0.1 ppm)
+ *
+ * One step of the aging offset is about 0.1 ppm. A fast RTC needs a
+ * higher aging offset.
+ */
+static bool trimAgingOffset(int16_t driftX10)
+{
+  int16_t oldAging = rtc.getAgingOffset();
+  int16_t newAging = oldAging + driftX10;
+  if (newAging > 127) {
+    newAging = 127;
+  } else if (newAging < -128) {
+    newAging = -128;
+  }
+  if (newAging == oldAging) {
+    return false;
+  }
+  DIAGPRINT(F("Aging offset old=")); DIAGPRINT(oldAging);
+  DIAGPRINT(F(" new=")); DIAGPRINTLN(newAging);
+  rtc.setAgingOffset(newAging);
+  return true;
+}
+
+/*
+ * Add the offset of a time sync (the real time minus the RTC)
+ *
+ * The round trip time of the time sync adds to the uncertainty of the
+ * offset, on top of the one second of both clocks.
+ */
+void updateClockDrift(uint32_t ts, int32_t offset, uint16_t rtt)
+{
+  offset += corrections;
+  uint8_t uncertainty = 1 + (rtt + 1999) / 2000;
+  if (!haveReference) {
+    setReference(ts, offset, uncertainty);
+    return;
+  }
+
+  uint32_t span = ts - refTs;
+  if ((int32_t)span < DRIFT_MIN_SPAN) {
+    return;
+  }
+  int32_t delta = offset - refOffset;
+  if (labs(delta) > 2000) {
+    // Must be a jump of the time, start over
+    setReference(ts, offset, uncertainty);
+    return;
+  }
+  // A fast RTC gets ahead, the offset goes down
+  int32_t driftX10 = -delta * 1000000L / (int32_t)(span / 10);
+  uint8_t error = refUncertainty + uncertainty;
+  DIAGPRINT(F("Clock drift=")); DIAGPRINT(driftX10);
+  DIAGPRINT(F("e-7 span=")); DIAGPRINT(span);
+  DIAGPRINT(F(" delta=")); DIAGPRINT(delta);
+  DIAGPRINT(F(" +/-")); DIAGPRINTLN(error);
+  if (labs(driftX10) > DRIFT_MAX_X10) {
+    // Not a real drift, start over
+    setReference(ts, offset, uncertainty);
+    return;
+  }
+
+  if (labs(delta) >= DRIFT_TRIM_FACTOR * error) {
+    if (trimAgingOffset(driftX10)) {
+      // The drift is different from now on
+      setReference(ts, offset, uncertainty);
+      return;
+    }
+  }
+
+  // The drift is at most (|delta| + error) / span
+  syncInterval = CLOCK_MAX_ERROR * span / (labs(delta) + error);
+}
+
+/*
+ * The RTC was corrected by the offset
+ */
+void addClockCorrection(int32_t offset)
+{
+  corrections += offset;
+}
+
+/*
+ * Get the time sync interval, at least the configured interval
+ *
+ * A stable RTC needs fewer time syncs.
+ */
+uint32_t getTimeSyncInterval(uint32_t interval)
+{
+  if (syncInterval > interval && interval < TIME_SYNC_MAX_INTERVAL) {
+    interval = syncInterval < TIME_SYNC_MAX_INTERVAL ? syncInterval : TIME_SYNC_MAX_INTERVAL;
+  }
+  return interval;
+}
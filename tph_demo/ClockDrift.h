@@ -0,0 +1,32 @@
+#ifndef CLOCKDRIFT_H_
+#define CLOCKDRIFT_H_
+
+#include <stdint.h>
+
+/*
+ * Drift of the RTC
+ *
+ * Each time sync gives the offset of the RTC. The drift is estimated from
+ * the offsets since a reference sync. When the drift is known well enough,
+ * the aging offset of the DS3231 is trimmed and a new reference is taken.
+ *
+ * The offsets are in whole seconds, so it takes a few days (or weeks for a
+ * good RTC) before the drift is known. In the mean time the estimate also
+ * says how long the RTC can run without a sync.
+ */
+// No estimate before this many seconds since the reference
+#define DRIFT_MIN_SPAN          (24L * 60 * 60)
+// Trim when the offset is this many times the uncertainty of the offset
+#define DRIFT_TRIM_FACTOR       2
+// Anything faster is a jump of the time, in 0.1 ppm
+#define DRIFT_MAX_X10           200
+// The error of the RTC that we allow between syncs, in seconds
+#define CLOCK_MAX_ERROR         10
+// Never wait longer for a time sync than this
+#define TIME_SYNC_MAX_INTERVAL  (7L * 24 * 60 * 60)
+
+void updateClockDrift(uint32_t ts, int32_t offset, uint16_t rtt);
+void addClockCorrection(int32_t offset);
+uint32_t getTimeSyncInterval(uint32_t interval);
+
+#endif /* CLOCKDRIFT_H_ */
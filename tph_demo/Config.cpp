@@ -10,7 +10,15 @@
 #define PARM_Ul         (60L * 60)           //   1 hour
 #define PARM_L          (120L * 60)          // 120 mins
 #define PARM_S          (24L * 60 * 60)      // 24 hours
-
+#define PARM_Ms         (0)                  // Never let the modem sleep
+#define PARM_Sn         (1)                  // One sample per record
+#define PARM_Dm         (0)                  // Store every record
+#define PARM_Dt         (2)                  // 0.2 degrees Celcius
+#define PARM_Dh         (10)                 // 1 %RH
+#define PARM_Dp         (5)                  // 0.5 hPa
+#define PARM_Dv         (50)                 // 50 mV
+
+#include <stddef.h>
 #include <stdint.h>
 #include <avr/pgmspace.h>
 #include <avr/eeprom.h>
@@ -24,20 +32,22 @@ static void * eepromAddr() { return (void *)0x40; }
 const char magic[] PROGMEM = "SODAQ";
 const char stationName_Default[] PROGMEM = "tph_demo";
 
+// The size of the config parameters before _ms was added
+#define CONFIG_SIZE_V1  (offsetof(ConfigParms, _ftpport) + sizeof(uint16_t))
+
 ConfigParms      parms;
 static bool needCommit;
 
 /*
- * Read all of the config parameters from the EEPROM
+ * Read the first dataSize bytes of the config parameters from the EEPROM
  *
- * There are some sanity checks. If they fail then
- * it will call reset() instead.
+ * The magic and the CRC must be OK, otherwise nothing is copied.
  */
-void ConfigParms::read()
+static bool readBlock(void *data, size_t dataSize)
 {
   const size_t crc_size = sizeof(uint16_t);
   const size_t magic_len = sizeof(magic);
-  size_t size = magic_len + sizeof(*this) + crc_size;
+  size_t size = magic_len + dataSize + crc_size;
   uint8_t buffer[size];
 
   //DIAGPRINT(F("magic_len=")); DIAGPRINTLN(magic_len);
@@ -51,19 +61,37 @@ void ConfigParms::read()
 
   if (strncmp_P((const char *)buffer, magic, magic_len) != 0) {
     //DIAGPRINTLN(F("ConfigParms::read - magic wrong"));
-    goto do_reset;
+    return false;
   }
   //DIAGPRINTLN(F("ConfigParms::read - magic OK"));
   //DIAGPRINT(F("crc=")); DIAGPRINTLN(crc);
   //DIAGPRINT(F("crc1=")); DIAGPRINTLN(crc1);
   if (crc != crc1) {
-    goto do_reset;
+    return false;
   }
-  memcpy((uint8_t *)this, buffer + magic_len, sizeof(*this));
-  return;
+  memcpy((uint8_t *)data, buffer + magic_len, dataSize);
+  return true;
+}
 
-do_reset:
+/*
+ * Read all of the config parameters from the EEPROM
+ *
+ * There are some sanity checks. If they fail then
+ * it will call reset() instead.
+ *
+ * A config of an older firmware is shorter, because the newer parameters
+ * are added at the end. The old parameters are kept, the new ones get
+ * their default value and the config is written back.
+ */
+void ConfigParms::read()
+{
+  if (readBlock(this, sizeof(*this))) {
+    return;
+  }
   reset();
+  if (readBlock(this, CONFIG_SIZE_V1)) {
+    DIAGPRINTLN(F("Old config, new parameters have their defaults"));
+  }
 }
 
 void ConfigParms::reset()
@@ -76,6 +104,13 @@ void ConfigParms::reset()
   _ul = PARM_Ul;
   _l = PARM_L;
   _s = PARM_S;
+  _ms = PARM_Ms;
+  _sn = PARM_Sn;
+  _dm = PARM_Dm;
+  _dt = PARM_Dt;
+  _dh = PARM_Dh;
+  _dp = PARM_Dp;
+  _dv = PARM_Dv;
 
   strncpy_P(_stationName, stationName_Default, sizeof(_stationName) - 1);
 
@@ -119,6 +154,13 @@ static const Command args[] = {
     {"long term upload",  "ul=",   Command::set_uint16, Command::show_uint16,  &parms._ul},
     {"long term begin",   "l=",    Command::set_uint16, Command::show_uint16,  &parms._l},
     {"sync RTC",          "rtc=",  Command::set_uint32, Command::show_uint32,  &parms._s},
+    {"modem sleep limit", "ms=",   Command::set_uint16, Command::show_uint16,  &parms._ms},
+    {"samples per record","sn=",   Command::set_uint16, Command::show_uint16,  &parms._sn},
+    {"max silence",       "dm=",   Command::set_uint16, Command::show_uint16,  &parms._dm},
+    {"deadband temp",     "dt=",   Command::set_uint16, Command::show_uint16,  &parms._dt},
+    {"deadband humidity", "dh=",   Command::set_uint16, Command::show_uint16,  &parms._dh},
+    {"deadband pressure", "dp=",   Command::set_uint16, Command::show_uint16,  &parms._dp},
+    {"deadband battery",  "dv=",   Command::set_uint16, Command::show_uint16,  &parms._dv},
     {"station name",      "nm=",   Command::set_string, Command::show_string,  parms._stationName, sizeof(parms._stationName)},
     {"APN",               "apn=",  Command::set_string, Command::show_string,  parms._apn, sizeof(parms._apn)},
     {"FTP server",        "srv=",  Command::set_string, Command::show_string,  parms._ftpsrv, sizeof(parms._ftpsrv)},
@@ -13,6 +13,8 @@
 #include "SQ_Command.h"
 #include "SQ_Diag.h"
 
+// The size of the station name, including the terminating NUL
+#define STATION_NAME_SIZE       20
 
 class ConfigParms
 {
@@ -23,12 +25,20 @@ public:
   uint16_t      _ul;
   uint16_t      _l;
   uint32_t      _s;
-  char          _stationName[20];
+  char          _stationName[STATION_NAME_SIZE];
   char          _apn[25];               // Is this enough for the APN?
   char          _ftpsrv[25];            // Is this enough for the server name?
   char          _ftpusr[16];            // Is this enough for the server user?
   char          _ftppw[16];             // Is this enough for the server password?
   uint16_t      _ftpport;
+  // New parameters must be added at the end, see read()
+  uint16_t      _ms;
+  uint16_t      _sn;
+  uint16_t      _dm;
+  uint16_t      _dt;
+  uint16_t      _dh;
+  uint16_t      _dp;
+  uint16_t      _dv;
 
 public:
   void read();
@@ -43,6 +53,13 @@ public:
   uint16_t getUl() const { return _ul; }
   uint16_t getL() const { return _l; }
   uint32_t getS() const { return _s; }
+  uint16_t getMs() const { return _ms; }
+  uint16_t getSn() const { return _sn; }
+  uint16_t getDm() const { return _dm; }
+  uint16_t getDt() const { return _dt; }
+  uint16_t getDh() const { return _dh; }
+  uint16_t getDp() const { return _dp; }
+  uint16_t getDv() const { return _dv; }
   const char *getStationName() const { return _stationName; }
   const char *getAPN() const { return _apn; }
   const char *getFTPserver() const { return _ftpsrv; }
@@ -21,50 +21,72 @@ bool DataRecord_t::isValidRecord() const
   return true;
 }
 
-void DataRecord_t::addToString(String & str) const
+/*
+ * Add a CSV field, with a comma before it. No value is an empty field.
+ */
+static void addValue(TextBuf & str, int16_t value)
+{
+  str.add(',');
+  if (value != (int16_t)DATA_NO_VALUE) {
+    str.add(value);
+  }
+}
+
+static void addValue(TextBuf & str, uint16_t value)
+{
+  str.add(',');
+  if (value != (uint16_t)DATA_NO_VALUE) {
+    str.add(value);
+  }
+}
+
+void DataRecord_t::addToString(TextBuf & str) const
 {
-  str.reserve(80);
-  str += ts;
-  str += ',';
-  str += temp_sht21;
-  str += ',';
-  str += hum_sht21;
-  str += ',';
-  str += temp_bmp85;
-  str += ',';
-  str += pres_bmp85;
-  str += ',';
-  str += batteryVoltage;
+  str.add(ts);
+#define DATA_CHANNEL_VALUE(name, type, sensor, index, deadband) \
+  addValue(str, name);
+  DATA_CHANNELS(DATA_CHANNEL_VALUE)
+  str.add(',');
+  str.add(repeats);
+#if ENABLE_RECORD_STATS
+  str.add(',');
+  str.add(nrSamples);
+  for (uint8_t i = 0; i < NR_CHANNELS; ++i) {
+    addValue(str, stats[i].min);
+    addValue(str, stats[i].max);
+    addValue(str, stats[i].stddev);
+  }
+#endif
 }
 
-void DataRecord_t::addHeaderToString(String & str)
+/*
+ * \brief The CSV header with the field names, in PROGMEM
+ */
+PGM_P DataRecord_t::getHeader()
 {
-  str.reserve(100);
-  PGM_P ptr = PSTR("ts"
-      ",temp_sht21,hum_sht21,temp_bmp85,pres_bmp85"
-      ",batteryVoltage"
+#define DATA_CHANNEL_NAME(name, type, sensor, index, deadband) "," #name
+#define DATA_CHANNEL_STATS_NAMES(name, type, sensor, index, deadband) \
+  "," #name "_min," #name "_max," #name "_sd"
+  return PSTR("ts"
+      DATA_CHANNELS(DATA_CHANNEL_NAME)
+      ",repeats"
+#if ENABLE_RECORD_STATS
+      ",nrSamples"
+      DATA_CHANNELS(DATA_CHANNEL_STATS_NAMES)
+#endif
       );
-  char c;
-  do {
-    c = pgm_read_byte_near(ptr++);
-    if (c) {
-      str += c;
-    }
-  } while (c != '\0');
 }
 
 #ifdef ENABLE_DIAG
 //################ print all values of the record ################
 void DataRecord_t::printRecordHeader() const
 {
-  String str;
-  addHeaderToString(str);
-  DIAGPRINTLN(str.c_str());
+  DIAGPRINTLN(reinterpret_cast<const __FlashStringHelper *>(getHeader()));
 }
 
 void DataRecord_t::printRecord() const
 {
-  String str;
+  TextBufN<DATA_RECORD_MAX_TEXT + 1> str;
   addToString(str);
   DIAGPRINTLN(str.c_str());
 }
@@ -1,28 +1,110 @@
 #ifndef DATARECORD_H
 #define DATARECORD_H
 
-#include <WString.h>
+#include <avr/pgmspace.h>
+#include <Sodaq_TextBuf.h>
+
+// Make it 1 to store the min, max and standard deviation of the samples
+// of each channel in the record. The values are the mean. This makes a
+// record about four times as large, so fewer fit in the dataflash and the
+// uploads take longer.
+#define ENABLE_RECORD_STATS     0
+
+// Make it 1 to add the temperature of the DS3231 to the record
+#define ENABLE_RTC_TEMP         0
+
+/*
+ * The channels of a record
+ *
+ * For each channel: the name, the type of the field in the record, the
+ * sensor driver (see Sensors.h), the index of the value in that driver,
+ * and the deadband (see isRecordChanged). A deadband of 0xFFFF means that
+ * the channel never causes a record to be stored.
+ * This table generates the record layout, the CSV header and values, the
+ * statistics and the acquisition of the sensors. A driver is started
+ * through its first value (index 0).
+ *
+ * Any change here needs a new DATA_VERSION.
+ */
+#if ENABLE_RTC_TEMP
+#define DATA_CHANNELS_RTC(X) \
+  X(temp_rtc,           int16_t,        rtcTempSensor,  0,      parms.getDt())
+#else
+#define DATA_CHANNELS_RTC(X)
+#endif
+
+#define DATA_CHANNELS(X) \
+  X(temp_sht21,         int16_t,        sht21Sensor,    0,      parms.getDt()) \
+  X(hum_sht21,          uint16_t,       sht21Sensor,    1,      parms.getDh()) \
+  X(temp_bmp85,         int16_t,        bmp085Sensor,   0,      parms.getDt()) \
+  X(pres_bmp85,         uint16_t,       bmp085Sensor,   1,      parms.getDp()) \
+  X(batteryVoltage,     uint16_t,       batterySensor,  0,      parms.getDv()) \
+  DATA_CHANNELS_RTC(X)
 
 #define HEADER_MAGIC            "SODAQ"
-#define DATA_VERSION            7               // Please register at http://sodaq.net/
+
+// The value of a channel without any valid sample. In the CSV text the
+// field is empty.
+#define DATA_NO_VALUE           0x8000
+
+/*
+ * Each combination of the ENABLE_ flags above is a different record
+ * layout, with its own DATA_VERSION. Please register new versions at
+ * http://sodaq.net/
+ */
+#define DATA_LAYOUT     ((ENABLE_RECORD_STATS) | (ENABLE_RTC_TEMP) << 1)
+#if DATA_LAYOUT == 0
+#define DATA_VERSION            10
+#elif DATA_LAYOUT == 1          // stats
+#define DATA_VERSION            11
+#elif DATA_LAYOUT == 2          // rtc temp
+#define DATA_VERSION            14
+#elif DATA_LAYOUT == 3          // stats, rtc temp
+#define DATA_VERSION            15
+#else
+#error "No DATA_VERSION for this combination of ENABLE_RECORD_STATS and ENABLE_RTC_TEMP"
+#endif
+
+enum {
+#define DATA_CHANNEL_ENUM(name, type, sensor, index, deadband)  CHANNEL_##name,
+  DATA_CHANNELS(DATA_CHANNEL_ENUM)
+  NR_CHANNELS
+};
+
+struct ChannelStats_t
+{
+  int16_t       min;
+  int16_t       max;
+  uint16_t      stddev;
+};
+typedef struct ChannelStats_t ChannelStats_t;
+
+// The maximum length of a record as CSV text
+#if ENABLE_RECORD_STATS
+#define DATA_RECORD_MAX_TEXT    (20 + NR_CHANNELS * 28)
+#else
+#define DATA_RECORD_MAX_TEXT    (20 + NR_CHANNELS * 7)
+#endif
 
 struct DataRecord_t
 {
   uint32_t      ts;             // seconds since epoch (01-jan-1970)
 
-  //SHT21
-  int16_t       temp_sht21;
-  uint16_t      hum_sht21;
+#define DATA_CHANNEL_FIELD(name, type, sensor, index, deadband)  type name;
+  DATA_CHANNELS(DATA_CHANNEL_FIELD)
 
-  //BMP085
-  int16_t       temp_bmp85;
-  uint16_t      pres_bmp85;
+  // The number of records before this one that were not stored, because
+  // they did not differ enough from the previous stored record. They were
+  // made at the regular interval after the previous stored record.
+  uint16_t      repeats;
 
-  //battery
-  uint16_t      batteryVoltage;
+#if ENABLE_RECORD_STATS
+  uint8_t       nrSamples;
+  ChannelStats_t stats[NR_CHANNELS];
+#endif
   bool isValidRecord() const;
-  void addToString(String & str) const;
-  static void addHeaderToString(String & str);
+  void addToString(TextBuf & str) const;
+  static PGM_P getHeader();
 #ifdef ENABLE_DIAG
   void printRecordHeader() const;
   void printRecord() const;
@@ -0,0 +1,66 @@
+#include <Arduino.h>
+#include <GPRSbee.h>
+#include <Sodaq_dataflash.h>
+
+#include "DeviceIdentity.h"
+#include "SQ_Diag.h"
+#include "SQ_Utils.h"
+
+static DeviceIdentity_t identity;
+
+/*
+ * Compute the device ID from the dataflash security register
+ *
+ * The dataflash must be initialized.
+ */
+void initDeviceIdentity()
+{
+  uint8_t buffer[128];
+  dflash.readSecurityReg(buffer, 128);
+  /* An example of the second 64 bytes of the security register
+0D0414071A2D1F2600011204FFFFE8FF
+303032533636313216140AFFFFFFFFFF
+3E3E3E3E3E3C3E3E3E3C3E3C3C3E3E3C
+FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF
+   */
+  //dumpBuffer(buffer + 64, 64);
+  identity.crc1 = crc16_ccitt(buffer + 64, 16);
+  identity.crc2 = crc16_ccitt(buffer + 64 + 16, 16);
+}
+
+/*
+ * Get the IMEI and the ICCID from the modem, if not done yet
+ *
+ * The modem must be on.
+ */
+void readModemIdentity()
+{
+  if (identity.imei[0] == '\0') {
+    if (gprsbee.getIMEI(identity.imei, sizeof(identity.imei))) {
+      DIAGPRINT(F("IMEI ")); DIAGPRINTLN(identity.imei);
+    } else {
+      identity.imei[0] = '\0';
+    }
+  }
+  if (identity.iccid[0] == '\0') {
+    if (gprsbee.getCCID(identity.iccid, sizeof(identity.iccid))) {
+      DIAGPRINT(F("ICCID ")); DIAGPRINTLN(identity.iccid);
+    } else {
+      identity.iccid[0] = '\0';
+    }
+  }
+}
+
+const DeviceIdentity_t & getDeviceIdentity()
+{
+  return identity;
+}
+
+/*
+ * Add the unique device id, 8 hex digits
+ */
+void addDeviceId(TextBuf & str)
+{
+  str.add04x(identity.crc1);
+  str.add04x(identity.crc2);
+}
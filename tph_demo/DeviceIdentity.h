@@ -0,0 +1,29 @@
+#ifndef DEVICEIDENTITY_H_
+#define DEVICEIDENTITY_H_
+
+#include <stdint.h>
+#include <Sodaq_TextBuf.h>
+
+/*
+ * The identity of the device
+ *
+ * The device ID is derived from the dataflash security register. It is
+ * read once at startup, because it is needed for each upload and each
+ * time sync. The IMEI and the ICCID are filled in the first time the
+ * modem is up, until then they are empty.
+ */
+struct DeviceIdentity_t
+{
+  uint16_t      crc1;                   // CRC16 of the factory bytes of the security register
+  uint16_t      crc2;
+  char          imei[15 + 1];           // Of the modem
+  char          iccid[20 + 1];          // Of the SIM card
+};
+typedef struct DeviceIdentity_t DeviceIdentity_t;
+
+void initDeviceIdentity();
+void readModemIdentity();
+const DeviceIdentity_t & getDeviceIdentity();
+void addDeviceId(TextBuf & str);
+
+#endif /* DEVICEIDENTITY_H_ */
@@ -53,6 +53,30 @@ void setupWatchdog()
   my_wdt_enable(WDTO_1S);
 }
 
+/*
+ * Set the watchdog to the longest period that fits in the number of seconds
+ *
+ * The periods are 1, 2, 4 or 8 seconds. The return value is the number of
+ * seconds of the chosen period.
+ */
+uint8_t setWatchdogSeconds(uint32_t secs)
+{
+  if (secs >= 8) {
+    my_wdt_enable(WDTO_8S);
+    return 8;
+  }
+  if (secs >= 4) {
+    my_wdt_enable(WDTO_4S);
+    return 4;
+  }
+  if (secs >= 2) {
+    my_wdt_enable(WDTO_2S);
+    return 2;
+  }
+  my_wdt_enable(WDTO_1S);
+  return 1;
+}
+
 //################ interrupt ################
 ISR(WDT_vect)
 {
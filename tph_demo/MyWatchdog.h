@@ -1,9 +1,12 @@
 #ifndef MYWATCHDOG_H_
 #define MYWATCHDOG_H_
 
+#include <stdint.h>
+
 extern bool hz_flag;
 
 void setupWatchdog();
+uint8_t setWatchdogSeconds(uint32_t secs);
 
 
 #endif /* MYWATCHDOG_H_ */
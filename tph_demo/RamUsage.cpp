@@ -0,0 +1,173 @@
+#include <Arduino.h>
+
+#include "RamUsage.h"
+#include "SQ_Diag.h"
+
+#if ENABLE_RAM_USAGE
+
+#define STACK_PAINT             0xC5
+
+extern uint8_t __heap_start;
+extern uint8_t *__brkval;
+
+static uint16_t maxStackDepth;
+static uint16_t maxHeapUsed;
+static uint16_t sectionStackDepth[NR_RAM_SECTIONS];
+static uint16_t sectionHeapUsed[NR_RAM_SECTIONS];
+
+/*
+ * Paint all RAM above .bss, before the stack is even set up
+ *
+ * This runs in .init1, so it cannot use the stack or r1.
+ * See also saveR2(), which must still find r2 untouched.
+ */
+extern "C" {
+void paintStack() __attribute__((section(".init1"), __naked__, __used__));
+void paintStack(void)
+{
+  __asm__ __volatile__ (
+      "    ldi r30,lo8(__heap_start)\n"
+      "    ldi r31,hi8(__heap_start)\n"
+      "    ldi r24,%[paint]\n"
+      "    ldi r25,hi8(__stack)\n"
+      "    rjmp 2f\n"
+      "1:  st Z+,r24\n"
+      "2:  cpi r30,lo8(__stack)\n"
+      "    cpc r31,r25\n"
+      "    brlo 1b\n"
+      "    breq 1b\n"
+      : : [paint] "M" (STACK_PAINT));
+}
+}
+
+static uint8_t *getHeapEnd()
+{
+  return __brkval ? __brkval : &__heap_start;
+}
+
+static uint16_t getHeapUsed()
+{
+  return getHeapEnd() - &__heap_start;
+}
+
+/*
+ * Find the lowest byte of the stack that was ever used
+ */
+static uint8_t *findStackLow()
+{
+  uint8_t *p = getHeapEnd();
+  uint8_t *sp = (uint8_t *)SP;
+  while (p < sp && *p == STACK_PAINT) {
+    ++p;
+  }
+  return p;
+}
+
+static uint16_t stackDepth(const uint8_t *low)
+{
+  return (uint8_t *)RAMEND - low + 1;
+}
+
+/*
+ * Update the overall maxima, return the current stack low
+ */
+static uint8_t *updateMax()
+{
+  uint8_t *low = findStackLow();
+  uint16_t depth = stackDepth(low);
+  if (depth > maxStackDepth) {
+    maxStackDepth = depth;
+  }
+  uint16_t heap = getHeapUsed();
+  if (heap > maxHeapUsed) {
+    maxHeapUsed = heap;
+  }
+  return low;
+}
+
+/*
+ * The number of bytes between the heap and the deepest stack so far
+ */
+uint16_t getStackHeadroom()
+{
+  return updateMax() - getHeapEnd();
+}
+
+uint16_t getMaxStackDepth()
+{
+  updateMax();
+  return maxStackDepth;
+}
+
+uint16_t getMaxHeapUsed()
+{
+  updateMax();
+  return maxHeapUsed;
+}
+
+void beginRamSection()
+{
+  // Below the stack low it is still painted
+  uint8_t *p = updateMax();
+  uint8_t *sp = (uint8_t *)SP;
+  while (p < sp) {
+    *p++ = STACK_PAINT;
+  }
+}
+
+void endRamSection(uint8_t section)
+{
+  uint16_t depth = stackDepth(updateMax());
+  if (depth > sectionStackDepth[section]) {
+    sectionStackDepth[section] = depth;
+  }
+  uint16_t heap = getHeapUsed();
+  if (heap > sectionHeapUsed[section]) {
+    sectionHeapUsed[section] = heap;
+  }
+}
+
+/*
+ * Add the maxima as a comment line for the upload file (without CR LF)
+ *
+ *   #ram,stack=<n>,headroom=<n>,heap=<n>,upload=<stack>/<heap>,timesync=<stack>/<heap>
+ */
+void addRamUsage(TextBuf & str)
+{
+  static const char * const sectionNames[NR_RAM_SECTIONS] PROGMEM = {
+    ",upload=",
+    ",timesync=",
+  };
+  uint16_t headroom = getStackHeadroom();
+  str.add(F("#ram,stack="));
+  str.add(maxStackDepth);
+  str.add(F(",headroom="));
+  str.add(headroom);
+  str.add(F(",heap="));
+  str.add(maxHeapUsed);
+  for (uint8_t i = 0; i < NR_RAM_SECTIONS; ++i) {
+    str.addP((PGM_P)pgm_read_word(&sectionNames[i]));
+    str.add(sectionStackDepth[i]);
+    str.add('/');
+    str.add(sectionHeapUsed[i]);
+  }
+}
+
+#ifdef ENABLE_DIAG
+/*
+ * Show the maximum stack depth and heap usage, overall and per section
+ */
+void showRamUsage()
+{
+  DIAGPRINT(F("stack max ")); DIAGPRINT(getMaxStackDepth());
+  DIAGPRINT(F(" headroom ")); DIAGPRINT(getStackHeadroom());
+  DIAGPRINT(F(" heap max ")); DIAGPRINTLN(maxHeapUsed);
+  for (uint8_t i = 0; i < NR_RAM_SECTIONS; ++i) {
+    DIAGPRINT(F(" section ")); DIAGPRINT(i);
+    DIAGPRINT(F(" stack ")); DIAGPRINT(sectionStackDepth[i]);
+    DIAGPRINT(F(" heap ")); DIAGPRINTLN(sectionHeapUsed[i]);
+  }
+}
+#endif
+
+#endif /* ENABLE_RAM_USAGE */
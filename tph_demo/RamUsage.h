@@ -0,0 +1,56 @@
+#ifndef RAMUSAGE_H_
+#define RAMUSAGE_H_
+
+#include <stdint.h>
+#include <Sodaq_TextBuf.h>
+#include "SQ_Diag.h"
+
+// Make it 0 to leave out the measurement of the stack and heap usage
+#define ENABLE_RAM_USAGE        1
+
+/*
+ * RAM usage: stack high water mark and heap usage
+ *
+ * At reset the free RAM between the heap and the top of the stack is
+ * painted with a fixed pattern. The deepest stack ever used is found by
+ * looking for the lowest byte that no longer has that pattern.
+ *
+ * A section (e.g. the upload) is measured by repainting the free RAM in
+ * beginRamSection() and looking again in endRamSection(). Sections
+ * cannot be nested. Repainting and looking both touch all free RAM, so
+ * do it only around the larger jobs.
+ *
+ * These are maxima of the device since the reset, so they are not part
+ * of the records. Each upload file starts with one line of them, see
+ * addRamUsage(). showRamUsage() reports them in the diag output, after
+ * each upload and in the system check.
+ */
+enum {
+  RAM_SECTION_UPLOAD,
+  RAM_SECTION_TIMESYNC,
+  NR_RAM_SECTIONS
+};
+
+#if ENABLE_RAM_USAGE
+uint16_t getStackHeadroom();
+uint16_t getMaxStackDepth();
+uint16_t getMaxHeapUsed();
+
+void beginRamSection();
+void endRamSection(uint8_t section);
+
+// The longest text of addRamUsage()
+#define RAM_USAGE_MAX_TEXT      90
+void addRamUsage(TextBuf & str);
+#else
+#define beginRamSection()
+#define endRamSection(section)
+#endif
+
+#if ENABLE_RAM_USAGE && defined(ENABLE_DIAG)
+void showRamUsage();
+#else
+#define showRamUsage()
+#endif
+
+#endif /* RAMUSAGE_H_ */
@@ -74,16 +74,24 @@ bool readPageHeader(int page, PageHeader_t *hdr)
  * \brief Read one record from the page
  */
 bool readPageNthRecord(int page, uint8_t nth, DataRecord_t *rec)
+{
+  dflash.readPageToBuf1(page);
+  return readBuf1NthRecord(nth, rec);
+}
+
+/*
+ * \brief Read one record of the page that is in buffer 1
+ */
+bool readBuf1NthRecord(uint8_t nth, DataRecord_t *rec)
 {
   size_t byte_offset = sizeof(PageHeader_t) + nth * sizeof(DataRecord_t);
   size_t size = sizeof(DataRecord_t);
-  if ((byte_offset + size) > DF_PAGE_SIZE) {
+  if ((byte_offset + size) > dflash.getPageSize()) {
     // The record is crossing page boundary
     clearRecord(rec);
     return false;
   }
 
-  dflash.readPageToBuf1(page);
   uint8_t *buffer = (uint8_t *)rec;
   while (size > 0) {
     int size1 = size >= 16 ? 16 : size;
@@ -96,6 +104,23 @@ bool readPageNthRecord(int page, uint8_t nth, DataRecord_t *rec)
   return rec->isValidRecord();
 }
 
+/*
+ * \brief Start reading one record of the page that is in buffer 1
+ *
+ * The record is read in the background, see Sodaq_Dataflash::isTransferDone().
+ */
+bool startReadBuf1NthRecord(uint8_t nth, DataRecord_t *rec)
+{
+  size_t byte_offset = sizeof(PageHeader_t) + nth * sizeof(DataRecord_t);
+  if ((byte_offset + sizeof(DataRecord_t)) > dflash.getPageSize()) {
+    // The record is crossing page boundary
+    clearRecord(rec);
+    return false;
+  }
+  dflash.startReadStrBuf1(byte_offset, (uint8_t *)rec, sizeof(DataRecord_t));
+  return true;
+}
+
 /*
  * \brief Is this a valid page header
  */
@@ -142,7 +167,7 @@ void findCurAndUploadPage(int *curPage, int *uploadPage, uint16_t randomNum)
   PageHeader_t hdr;
 
   // First round, search for upload page
-  for (int page = 0; page < DF_NR_PAGES; ++page) {
+  for (int page = 0; page < dflash.getNrPages(); ++page) {
     readPage(page, (uint8_t*)&hdr, sizeof(hdr));
 
     if (isValidHeader(&hdr)) {
@@ -164,7 +189,7 @@ void findCurAndUploadPage(int *curPage, int *uploadPage, uint16_t randomNum)
     // Starting from upload page, look for the next free spot.
     // TODO Verify this logic
     int page = myUploadPage;
-    for (int nr = 0; nr < DF_NR_PAGES; ++nr, page = getNextPage(page)) {
+    for (int nr = 0; nr < dflash.getNrPages(); ++nr, page = getNextPage(page)) {
       readPage(page, (uint8_t*)&hdr, sizeof(hdr));
       if (!isValidHeader(&hdr)) {
         myCurPage = page;
@@ -179,7 +204,7 @@ void findCurAndUploadPage(int *curPage, int *uploadPage, uint16_t randomNum)
   } else {
     // No upload page found.
     // Start at a random place
-    myCurPage = randomNum % DF_NR_PAGES;
+    myCurPage = randomNum % dflash.getNrPages();
     myUploadPage = -1;
   }
 
@@ -215,7 +240,7 @@ void initNewPage(int page, uint32_t ts)
   dflash.writeStrBuf1(curByte, (uint8_t *)&hdr, sizeof(hdr));
   curByte += sizeof(hdr);
 
-  for (int b = curByte; b < DF_PAGE_SIZE; ++b) {
+  for (int b = curByte; b < dflash.getPageSize(); ++b) {
     dflash.writeByteBuf1(b, 0xff);
   }
 
@@ -283,7 +308,7 @@ void addCurPageRecord(DataRecord_t *rec, uint32_t ts)
   //DIAGPRINT(F("addCurPageRecord:")); DIAGPRINTLN(curPage);
   //DIAGPRINT(F(" curByte:")); DIAGPRINTLN(curByte);
   // Is there enough room for a new record in the current page?
-  if (curPage < 0 || curByte >= (int)(DF_PAGE_SIZE - sizeof(*rec))) {
+  if (curPage < 0 || curByte >= (int)(dflash.getPageSize() - sizeof(*rec))) {
     // No, so start using the next page
     //DIAGPRINT(F("addCurPageRecord:")); DIAGPRINTLN(curPage);
     //dumpPage(curPage);
@@ -323,7 +348,7 @@ void readAllPages()
   uint32_t start = millis();
 #endif
 
-  for (uint16_t page = 0; page < DF_NR_PAGES; page++) {
+  for (uint16_t page = 0; page < dflash.getNrPages(); page++) {
     PageHeader_t hdr;
     readPage(page, (uint8_t*)&hdr, sizeof(hdr));
   }
@@ -345,10 +370,10 @@ void dumpPage(int page)
   DIAGPRINT(F("page ")); DIAGPRINTLN(page);
   dflash.readPageToBuf1(page);
   uint8_t buffer[16];
-  for (uint16_t i = 0; i < DF_PAGE_SIZE; i += sizeof(buffer)) {
+  for (uint16_t i = 0; i < dflash.getPageSize(); i += sizeof(buffer)) {
     size_t nr = sizeof(buffer);
-    if ((i + nr) > DF_PAGE_SIZE) {
-      nr = DF_PAGE_SIZE - i;
+    if ((i + nr) > dflash.getPageSize()) {
+      nr = dflash.getPageSize() - i;
     }
     dflash.readStrBuf1(i, buffer, nr);
 
@@ -356,4 +381,88 @@ void dumpPage(int page)
   }
 }
 
+static void showSpeed(const __FlashStringHelper *txt, uint32_t nrBytes, uint32_t elapse)
+{
+  if (elapse == 0) {
+    elapse = 1;
+  }
+  DIAGPRINT(txt);
+  DIAGPRINT(nrBytes * 1000 / elapse * 1000 / 1024); DIAGPRINT(F(" KB/s, "));
+  DIAGPRINT(elapse * (F_CPU / 1000000) / nrBytes); DIAGPRINTLN(F(" cycles/byte"));
+}
+
+/*
+ * Some CPU work, to run during a transfer
+ */
+static void busyWork(uint16_t n)
+{
+  volatile uint8_t x = 0;
+  while (n--) {
+    x = x + 1;
+  }
+}
+
+/*
+ * \brief Measure the speed of writeStrBuf1 and readStrBuf1
+ *
+ * The old per-byte transfers are measured first, as a reference.
+ *
+ * The background read is measured together with some CPU work, once
+ * after a synchronous read and once during a background read. The
+ * background read is only useful if the second one is faster.
+ *
+ * It overwrites the contents of dataflash buffer 1.
+ * This function is just meant for diagnostics.
+ */
+void benchmarkDataflash()
+{
+  const uint8_t nrLoops = 64;
+  uint8_t buffer[256];
+  for (size_t i = 0; i < sizeof(buffer); ++i) {
+    buffer[i] = i;
+  }
+
+  uint32_t start = micros();
+  for (uint8_t i = 0; i < nrLoops; ++i) {
+    dflash.writeStrBuf1PerByte(0, buffer, sizeof(buffer));
+  }
+  showSpeed(F("writeStrBuf1, per byte: "), (uint32_t)nrLoops * sizeof(buffer), micros() - start);
+
+  start = micros();
+  for (uint8_t i = 0; i < nrLoops; ++i) {
+    dflash.readStrBuf1PerByte(0, buffer, sizeof(buffer));
+  }
+  showSpeed(F("readStrBuf1, per byte: "), (uint32_t)nrLoops * sizeof(buffer), micros() - start);
+
+  start = micros();
+  for (uint8_t i = 0; i < nrLoops; ++i) {
+    dflash.writeStrBuf1(0, buffer, sizeof(buffer));
+  }
+  showSpeed(F("writeStrBuf1: "), (uint32_t)nrLoops * sizeof(buffer), micros() - start);
+
+  start = micros();
+  for (uint8_t i = 0; i < nrLoops; ++i) {
+    dflash.readStrBuf1(0, buffer, sizeof(buffer));
+  }
+  showSpeed(F("readStrBuf1: "), (uint32_t)nrLoops * sizeof(buffer), micros() - start);
+
+  // The size of a record, with about the work of making its line
+  const uint8_t recSize = 32;
+  const uint16_t work = 400;
+  start = micros();
+  for (uint8_t i = 0; i < nrLoops; ++i) {
+    dflash.readStrBuf1(0, buffer, recSize);
+    busyWork(work);
+  }
+  showSpeed(F("readStrBuf1 + work: "), (uint32_t)nrLoops * recSize, micros() - start);
+
+  start = micros();
+  for (uint8_t i = 0; i < nrLoops; ++i) {
+    dflash.startReadStrBuf1(0, buffer, recSize);
+    busyWork(work);
+    dflash.waitTransferDone();
+  }
+  showSpeed(F("startReadStrBuf1 + work: "), (uint32_t)nrLoops * recSize, micros() - start);
+}
+
 #endif
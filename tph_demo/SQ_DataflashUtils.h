@@ -28,7 +28,7 @@ struct PageHeader_t
 typedef struct PageHeader_t PageHeader_t;
 
 
-#define NR_RECORDS_PER_PAGE     ((DF_PAGE_SIZE - sizeof(PageHeader_t)) / sizeof(DataRecord_t))
+#define NR_RECORDS_PER_PAGE     ((dflash.getPageSize() - sizeof(PageHeader_t)) / sizeof(DataRecord_t))
 
 extern int curPage;
 extern int uploadPage;
@@ -36,7 +36,7 @@ extern int uploadPage;
 static inline int getNextPage(int page)
 {
   page++;
-  if (page >= DF_NR_PAGES) {
+  if (page >= dflash.getNrPages()) {
     page = 0;
   }
   return page;
@@ -49,6 +49,8 @@ void findCurAndUploadPage(int *curPage, int *uploadPage, uint16_t randomNum);
 uint32_t getPageTS(int page);
 void readPage(int page, uint8_t *buffer, unsigned int size);
 bool readPageNthRecord(int page, uint8_t nth, DataRecord_t *rec);
+bool readBuf1NthRecord(uint8_t nth, DataRecord_t *rec);
+bool startReadBuf1NthRecord(uint8_t nth, DataRecord_t *rec);
 bool readPageHeader(int page, PageHeader_t *hdr);
 
 void initNewPage(int page, uint32_t ts);
@@ -61,9 +63,11 @@ void restoreCurPage();
 #ifdef ENABLE_DIAG
 void readAllPages();
 void dumpPage(int page);
+void benchmarkDataflash();
 #else
 #define readAllPages()
 #define dumpPage(page)
+#define benchmarkDataflash()
 #endif
 
 #endif /* SQ_DATAFLASHUTILS_H_ */
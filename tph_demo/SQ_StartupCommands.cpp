@@ -28,6 +28,22 @@ static void eraseFlash(const Command *a, const char *line)
   dflash.chipErase();
   DIAGPRINTLN(F("done"));
 }
+static void benchmarkFlash(const Command *a, const char *line)
+{
+  benchmarkDataflash();
+}
+static void binaryPages(const Command *a, const char *line)
+{
+  if (dflash.isBinaryPageSize()) {
+    DIAGPRINTLN(F("Binary page size already"));
+    return;
+  }
+  // This is permanent. The pages are read back with the new size after
+  // a power cycle, the last bytes of each page are then lost.
+  DIAGPRINT(F("Switching to binary page size ..."));
+  dflash.setBinaryPageSize();
+  DIAGPRINTLN(F("done, please power cycle"));
+}
 #endif
 
 bool isTest;
@@ -40,6 +56,8 @@ static void enableTest(const Command *a, const char *line)
 static const Command args[] = {
 #if ENABLE_DATAFLASH_COMMANDS
     {"Erase Flash", "EF", eraseFlash, Command::show_string},
+    {"Benchmark Flash", "BF", benchmarkFlash, Command::show_string},
+    {"Binary Pages (permanent!)", "BP", binaryPages, Command::show_string},
 #endif
     {"Enable test", "ET", enableTest, Command::show_string},
 };
@@ -0,0 +1,85 @@
+/*
+ * Time sync providers
+ *
+ * The network time is read from the SIM900 (AT+CCLK?). It only makes
+ * sense if the GPRSbee is on and registered, and if it was told to get
+ * the network time (LTS). The clock of the SIM900 is only used after a
+ * network time update in this session. Otherwise it just runs free since
+ * the last one, and the time server must be used instead.
+ */
+
+#include <Arduino.h>
+#include <GPRSbee.h>
+#include <Sodaq_DS3231.h>
+
+#include "SQ_Diag.h"
+#include "SQ_TimeSync.h"
+
+/*
+ * Convert the reply of AT+CCLK? into seconds since epoch
+ *
+ * The reply looks like this:
+ *   "14/11/03,10:15:32+04"
+ * The last number is the time zone, in quarters of an hour.
+ */
+static bool parseCCLK(const char *str, uint32_t *ts)
+{
+  uint8_t value[6];             // yy MM dd hh mm ss
+  char *eptr;
+
+  // Skip the space and the opening quote
+  while (*str == ' ' || *str == '"') {
+    ++str;
+  }
+  for (uint8_t i = 0; i < sizeof(value); ++i) {
+    value[i] = strtoul(str, &eptr, 10);
+    if (eptr == str) {
+      return false;
+    }
+    // Skip the separator, but not the sign of the time zone
+    str = i < sizeof(value) - 1 ? eptr + 1 : eptr;
+  }
+  int tz = strtol(str, &eptr, 10);
+
+  // The SIM900 starts in 2004 if it never got the network time
+  if (value[0] < 14) {
+    return false;
+  }
+
+  DateTime dt(value[0], value[1], value[2], value[3], value[4], value[5], 0);
+  *ts = dt.getEpoch() - tz * 15L * 60;
+  return true;
+}
+
+/*
+ * Get the time from the network, via the GPRSbee
+ */
+bool getNetworkTime(TimeSyncResult_t *res)
+{
+  char buffer[30];
+  if (!gprsbee.isNetworkTimeFresh()) {
+    DIAGPRINTLN(F("No fresh network time"));
+    return false;
+  }
+  memset(buffer, 0, sizeof(buffer));
+  uint32_t start = millis();
+  if (!gprsbee.getCCLK(buffer, sizeof(buffer))) {
+    return false;
+  }
+  uint32_t end = millis();
+  if (!parseCCLK(buffer, &res->ts)) {
+    DIAGPRINTLN(F("No network time"));
+    return false;
+  }
+  res->rtt = end - start;
+  res->ms = start + res->rtt / 2;
+  return true;
+}
+
+/*
+ * Compute the timestamp of this moment from a time sync result
+ */
+uint32_t getTimeSyncNow(const TimeSyncResult_t & res)
+{
+  return res.ts + (millis() - res.ms + 500) / 1000;
+}
@@ -0,0 +1,26 @@
+/*
+ * SQ_TimeSync.h
+ *
+ * Time sync providers. A provider gets the current time from somewhere,
+ * for example the network time of the GPRSbee or a time server.
+ */
+
+#ifndef SQ_TIMESYNC_H_
+#define SQ_TIMESYNC_H_
+
+#include <stdint.h>
+
+struct TimeSyncResult_t
+{
+  uint32_t      ts;             // seconds since epoch, valid at millis() == ms
+  uint32_t      ms;
+  uint16_t      rtt;            // round trip time in milliseconds
+};
+typedef struct TimeSyncResult_t TimeSyncResult_t;
+
+typedef bool (*TimeSyncProvider)(TimeSyncResult_t *res);
+
+bool getNetworkTime(TimeSyncResult_t *res);
+uint32_t getTimeSyncNow(const TimeSyncResult_t & res);
+
+#endif /* SQ_TIMESYNC_H_ */
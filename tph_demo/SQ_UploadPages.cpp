@@ -8,6 +8,7 @@
 #include <GPRSbee.h>
 #include "SQ_Diag.h"
 #include "SQ_DataflashUtils.h"
+#include "RamUsage.h"
 
 #include "SQ_UploadPages.h"
 
@@ -20,7 +21,6 @@
 
 static bool addPageHeaderToFTP(int page);
 static int addOnePageToFTP(int page);
-static void addRecToString(const DataRecord_t & rec, String & str);
 static void erasePages(size_t nr_pages_sent);
 
 static void diagPrintlnFailed()
@@ -31,11 +31,14 @@ static void diagPrintlnFailed()
 /*
  * \brief Upload all available page
  *
+ * The optional function connected() is called as soon as the GPRSbee
+ * is connected. It can be used to do something else in the same session.
+ *
  * Please make sure that there is enough battery power.
  */
 #define MAX_NR_PAGES_SENT 200
 #define MAX_NR_RECORDS_SENT 400
-bool uploadPages(const char *filename, const ConfigParms & parms)
+bool uploadPages(const char *filename, const ConfigParms & parms, void (*connected)())
 {
   size_t nr_pages_sent = 0;
   size_t nr_recs_sent = 0;
@@ -53,6 +56,10 @@ bool uploadPages(const char *filename, const ConfigParms & parms)
     goto end;
   }
 
+  if (connected) {
+    (*connected)();
+  }
+
   // Open up the FTP session
   if (!gprsbee.openFTPfile(filename, FTPPATH)) {
     DIAGPRINT(F("openFTPfile")); diagPrintlnFailed();
@@ -143,56 +150,77 @@ static void erasePages(size_t nr_pages_sent)
   }
 }
 
-static const char *linePtr;
-uint8_t readNextByte2()
+static PGM_P headerPtr;
+static uint8_t headerEolIx;
+uint8_t readNextHeaderByte()
 {
-  return *linePtr++;
+  uint8_t c = pgm_read_byte_near(headerPtr);
+  if (c != '\0') {
+    ++headerPtr;
+    return c;
+  }
+  return headerEolIx++ == 0 ? '\r' : '\n';
 }
-static bool addLineToFTP(String & str)
+
+/*
+ * \brief Upload a CSV header with the field names
+ *
+ * It is sent straight from PROGMEM, followed by CR LF. Before it comes
+ * a comment line with the RAM usage, if that is measured.
+ */
+static bool addPageHeaderToFTP(int page)
 {
-  str += '\r';
-  str += '\n';
-  size_t len = str.length();
-  linePtr = str.c_str();
-  if (!gprsbee.sendFTPdata(readNextByte2, len)) {
+#if ENABLE_RAM_USAGE
+  TextBufN<RAM_USAGE_MAX_TEXT + 3> ram;
+  addRamUsage(ram);
+  ram.add(F("\r\n"));
+  if (!gprsbee.sendFTPdata((uint8_t *)ram.c_str(), ram.length())) {
+    DIAGPRINT(F("addPageHeaderToFTP")); diagPrintlnFailed();
+    return false;
+  }
+#endif
+  headerPtr = DataRecord_t::getHeader();
+  headerEolIx = 0;
+  size_t len = strlen_P(headerPtr) + 2;
+  if (!gprsbee.sendFTPdata(readNextHeaderByte, len)) {
     // An error.
-    DIAGPRINT(F("addLineToFTP")); diagPrintlnFailed();
+    DIAGPRINT(F("addPageHeaderToFTP")); diagPrintlnFailed();
     return false;
   }
   return true;
 }
 
 /*
- * \brief Upload a CSV header with the field names
+ * A record as CSV text, with CR LF
  */
-static bool addPageHeaderToFTP(int page)
-{
-  String str;
-  DataRecord_t::addHeaderToString(str);
-  return addLineToFTP(str);
-}
+typedef TextBufN<DATA_RECORD_MAX_TEXT + 3> RecordLine;
 
-static void addRecToString(const DataRecord_t & rec, String & str)
+static void addRecToString(const DataRecord_t & rec, TextBuf & str)
 {
   rec.addToString(str);
-  str += '\r';
-  str += '\n';
+  str.add('\r');
+  str.add('\n');
 }
 
 static size_t getRecLength(const DataRecord_t & rec)
 {
-  String str;
+  RecordLine str;
   addRecToString(rec, str);
   return str.length();
 }
 
 /*
  * \brief Upload a single page, all the records in it
+ *
+ * While the line of one record is sent to the modem, the next record is
+ * read from the dataflash buffer in the background. The read starts after
+ * the line is made, so that it runs while the CPU waits for the UART.
  */
-static int uPage;
 static DataRecord_t * uRec;
+static DataRecord_t * uNextRec;
 static uint8_t uRecIx;
-static String *uStr;
+static uint8_t uNrRecs;
+static TextBuf *uStr;
 static size_t uStrIx;
 uint8_t readNextByte()
 {
@@ -201,11 +229,17 @@ uint8_t readNextByte()
   }
   while (uStrIx >= uStr->length()) {
     // Read next record into string
-    *uStr = "";
+    uStr->clear();
     uStrIx = 0;
     wdt_reset();
-    readPageNthRecord(uPage, uRecIx++, uRec);           // No room for failure
+    dflash.waitTransferDone();
+    DataRecord_t * rec = uRec;
+    uRec = uNextRec;
+    uNextRec = rec;
     addRecToString(*uRec, *uStr);
+    if (++uRecIx < uNrRecs) {
+      startReadBuf1NthRecord(uRecIx, uNextRec);
+    }
   }
   return (*uStr)[uStrIx++];
 }
@@ -220,13 +254,17 @@ static int addOnePageToFTP(int page)
   //dumpPage(page);
 
   DataRecord_t rec;
+  DataRecord_t nextRec;
+
+  // The page stays in buffer 1 for both the length and the sending
+  dflash.readPageToBuf1(page);
 
   // Find out length
   size_t len = 0;
   int nrRecs = 0;
   for (uint8_t i = 0; i < NR_RECORDS_PER_PAGE; ++i) {
     wdt_reset();
-    if (!readPageNthRecord(page, i, &rec)) {
+    if (!readBuf1NthRecord(i, &rec)) {
       break;
     }
     len += getRecLength(rec);
@@ -234,14 +272,22 @@ static int addOnePageToFTP(int page)
   }
 
   // Send the whole page
-  String str;
+  RecordLine str;
   uStr = &str;
   uStrIx = 0;
-  uPage = page;
   uRec = &rec;
+  uNextRec = &nextRec;
   uRecIx = 0;
+  uNrRecs = nrRecs;
+  if (nrRecs > 0) {
+    startReadBuf1NthRecord(0, uNextRec);
+  }
   //DIAGPRINT(F("addOnePageToFTP: len=")); DIAGPRINTLN(len);
-  if (len > 0 && !gprsbee.sendFTPdata(readNextByte, len)) {
+  bool status = len == 0 || gprsbee.sendFTPdata(readNextByte, len);
+  // Don't leave a transfer into the records on the stack
+  dflash.waitTransferDone();
+  uStr = 0;
+  if (!status) {
     // An error.
     DIAGPRINT(F("addOneRecToFTP")); diagPrintlnFailed();
     return -1;
@@ -3,6 +3,6 @@
 
 #include "Config.h"
 
-bool uploadPages(const char *name, const ConfigParms & parms);
+bool uploadPages(const char *name, const ConfigParms & parms, void (*connected)() = 0);
 
 #endif /* SQ_UPLOADPAGES_H_ */
@@ -31,54 +31,6 @@ uint16_t crc16_ccitt(uint8_t * buf, size_t len)
     return crc;
 }
 
-/*
- * Format an integer with a certain width
- *
- */
-
-/*
- * Format an integer as %0*d
- *
- * Arduino formatting sucks.
- */
-void add0Nd(String &str, uint16_t val, size_t width)
-{
-  if (width >= 5 && val < 10000) {
-    str += '0';
-  }
-  if (width >= 4 && val < 1000) {
-    str += '0';
-  }
-  if (width >= 3 && val < 100) {
-    str += '0';
-  }
-  if (width >= 2 && val < 10) {
-    str += '0';
-  }
-  str += val;
-}
-
-/*
- * Format an integer as %0*x
- *
- * Arduino formatting sucks.
- */
-void add0Nx(String &str, uint16_t val, size_t width)
-{
-  char buf[5];
-  if (width >= 4 && val < 0x1000) {
-    str += '0';
-  }
-  if (width >= 3 && val < 0x100) {
-    str += '0';
-  }
-  if (width >= 2 && val < 0x10) {
-    str += '0';
-  }
-  utoa(val, buf, 16);
-  str += buf;
-}
-
 /*
  * Convert hex digits to a number
  *
@@ -118,17 +70,6 @@ bool getUValue(const char *buffer, uint32_t * value)
   return false;
 }
 
-void addPstrToString(String & str, PGM_P ptr)
-{
-  char c;
-  do {
-    c = pgm_read_byte_near(ptr++);
-    if (c) {
-      str += c;
-    }
-  } while (c != '\0');
-}
-
 /*
  * Fatal error, panic
  */
@@ -0,0 +1,103 @@
+/*
+ * SampleStats.cpp
+ */
+
+#include "SampleStats.h"
+
+// The largest difference with the first sample in the sums. The sum of 255
+// of these squares still fits in 32 bits. It is 409.5 in the 0.1 units of
+// the channels, so only a broken sensor can get there. The min and max
+// still have the real values.
+#define MAX_DIFF                4095
+
+static uint16_t isqrt(uint32_t value);
+
+void SampleStats::add(int16_t value)
+{
+  if (_count == 0) {
+    _min = value;
+    _max = value;
+    _first = value;
+    _sum = 0;
+    _sumSq = 0;
+  } else {
+    if (value < _min) {
+      _min = value;
+    }
+    if (value > _max) {
+      _max = value;
+    }
+  }
+  if (_count < 0xFF) {
+    int32_t diff = (int32_t)value - _first;
+    // Both sums must have the same samples, else the variance is wrong
+    if (diff > MAX_DIFF) {
+      diff = MAX_DIFF;
+    } else if (diff < -MAX_DIFF) {
+      diff = -MAX_DIFF;
+    }
+    _sum += diff;
+    _sumSq += (uint32_t)(diff * diff);
+    ++_count;
+  }
+}
+
+/*
+ * Return the mean, rounded to the nearest integer
+ */
+int16_t SampleStats::getMean() const
+{
+  if (_count == 0) {
+    return 0;
+  }
+  int32_t sum = _sum;
+  if (sum >= 0) {
+    sum += _count / 2;
+  } else {
+    sum -= _count / 2;
+  }
+  return _first + sum / _count;
+}
+
+/*
+ * Return the (population) standard deviation
+ *
+ *   variance = sum(x^2) / n - (sum(x) / n)^2
+ * with x relative to the first sample.
+ */
+uint16_t SampleStats::getStdDev() const
+{
+  if (_count < 2) {
+    return 0;
+  }
+  int32_t mean = _sum / _count;
+  uint32_t meanSq = (uint32_t)(mean < 0 ? -mean : mean);
+  meanSq *= meanSq;
+  uint32_t sumSq = _sumSq / _count;
+  if (meanSq >= sumSq) {
+    return 0;
+  }
+  return isqrt(sumSq - meanSq);
+}
+
+/*
+ * Integer square root, rounded down
+ */
+static uint16_t isqrt(uint32_t value)
+{
+  uint32_t result = 0;
+  uint32_t bit = 1UL << 30;
+  while (bit > value) {
+    bit >>= 2;
+  }
+  while (bit != 0) {
+    if (value >= result + bit) {
+      value -= result + bit;
+      result = (result >> 1) + bit;
+    } else {
+      result >>= 1;
+    }
+    bit >>= 2;
+  }
+  return result;
+}
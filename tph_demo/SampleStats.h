@@ -0,0 +1,35 @@
+/*
+ * SampleStats.h
+ *
+ * Statistics of a series of samples of one channel: mean, min, max and
+ * standard deviation, all in integer arithmetic.
+ */
+
+#ifndef SAMPLESTATS_H_
+#define SAMPLESTATS_H_
+
+#include <stdint.h>
+
+class SampleStats
+{
+public:
+  void clear() { _count = 0; }
+  void add(int16_t value);
+
+  uint8_t getCount() const { return _count; }
+  int16_t getMin() const { return _min; }
+  int16_t getMax() const { return _max; }
+  int16_t getMean() const;
+  uint16_t getStdDev() const;
+
+private:
+  uint8_t       _count;
+  int16_t       _min;
+  int16_t       _max;
+  // The sums are relative to the first sample, to keep them small
+  int16_t       _first;
+  int32_t       _sum;
+  uint32_t      _sumSq;
+};
+
+#endif /* SAMPLESTATS_H_ */
@@ -0,0 +1,107 @@
+/*
+ * Sensors.cpp
+ */
+
+#include <Arduino.h>
+#include <Sodaq_SHT2x.h>
+#include <Sodaq_BMP085.h>
+#include <Sodaq_DS3231.h>
+
+#include "Sensors.h"
+
+extern Sodaq_BMP085 bmp;
+uint16_t getBatteryMilliVolt();
+
+SHT21Sensor      sht21Sensor;
+BMP085Sensor     bmp085Sensor;
+BatterySensor    batterySensor;
+#if ENABLE_RTC_TEMP
+DS3231TempSensor rtcTempSensor;
+#endif
+
+//################ SHT21 ################
+void SHT21Sensor::start()
+{
+  _temp = 0;
+  _hum = 0;
+  _lastPoll = millis();
+  SHT2x.startTemperature();
+}
+
+bool SHT21Sensor::poll()
+{
+  if (_hum != 0) {
+    return true;
+  }
+  // Each poll is an I2C transaction, the SHT21 needs some tens of ms
+  if ((uint16_t)((uint16_t)millis() - _lastPoll) < 5) {
+    return false;
+  }
+  _lastPoll = millis();
+  if (_temp == 0) {
+    _temp = SHT2x.readResult();
+    if (_temp != 0) {
+      SHT2x.startHumidity();
+    }
+    return false;
+  }
+  _hum = SHT2x.readResult();
+  return _hum != 0;
+}
+
+int16_t SHT21Sensor::getValue(uint8_t i)
+{
+  if (i == 0) {
+    return SHT2x.calcTemperatureX10(_temp);
+  }
+  return SHT2x.calcHumidityX10(_hum);
+}
+
+//################ BMP085 ################
+void BMP085Sensor::start()
+{
+  _UT = 0;
+  _done = false;
+  _valid = false;
+  bmp.startRawTemperature();
+}
+
+bool BMP085Sensor::poll()
+{
+  if (_done) {
+    return true;
+  }
+  if (!bmp.isConversionDone()) {
+    return false;
+  }
+  if (_UT == 0) {
+    _UT = bmp.getRawTemperature();
+    bmp.startRawPressure();
+    return false;
+  }
+  _valid = bmp.calcTemperaturePressureX10(_UT, bmp.getRawPressure(), &_temp, &_pressure);
+  _done = true;
+  return true;
+}
+
+int16_t BMP085Sensor::getValue(uint8_t i)
+{
+  if (i == 0) {
+    return _temp;
+  }
+  return _pressure;
+}
+
+//################ battery ################
+void BatterySensor::start()
+{
+  _value = getBatteryMilliVolt();
+}
+
+//################ DS3231 ################
+#if ENABLE_RTC_TEMP
+void DS3231TempSensor::start()
+{
+  _value = rtc.getTemperatureX10();
+}
+#endif
@@ -0,0 +1,102 @@
+/*
+ * Sensors.h
+ *
+ * The sensor drivers. A driver delivers one or more values, already
+ * scaled to the units of the record (see DATA_CHANNELS in DataRecord.h).
+ *
+ * The DATA_CHANNELS table calls the drivers directly, so they have no
+ * common base class. Each driver has:
+ *   void start()               Start the conversion(s)
+ *   bool poll()                Continue the conversion(s), returns true
+ *                              when all values are ready
+ *   bool isValid()             Are the values real measurements? Not if
+ *                              the conversion did not finish or failed.
+ *   int16_t getValue(uint8_t i)
+ *                              Return one of the values, scaled to the
+ *                              units of the record
+ * Only the drivers of the channels in the table are compiled in.
+ */
+
+#ifndef SENSORS_H_
+#define SENSORS_H_
+
+#include <stdint.h>
+#include "DataRecord.h"
+
+/*
+ * SHT21, temperature (0.1 degC) and humidity (0.1 %RH)
+ *
+ * The two measurements are done one after the other.
+ */
+class SHT21Sensor
+{
+public:
+  void start();
+  bool poll();
+  bool isValid() const { return _temp != 0 && _hum != 0; }
+  int16_t getValue(uint8_t i);
+private:
+  // The raw values, 0 if there is none
+  uint16_t      _temp;
+  uint16_t      _hum;
+  uint16_t      _lastPoll;
+};
+
+/*
+ * BMP085, temperature (0.1 degC) and pressure (0.1 hPa)
+ */
+class BMP085Sensor
+{
+public:
+  void start();
+  bool poll();
+  bool isValid() const { return _valid; }
+  int16_t getValue(uint8_t i);
+private:
+  int32_t       _UT;
+  int16_t       _temp;
+  uint16_t      _pressure;
+  bool          _done;
+  bool          _valid;
+};
+
+/*
+ * Battery voltage (mV)
+ */
+class BatterySensor
+{
+public:
+  void start();
+  bool poll() { return true; }
+  bool isValid() const { return true; }
+  int16_t getValue(uint8_t) { return _value; }
+private:
+  uint16_t      _value;
+};
+
+#if ENABLE_RTC_TEMP
+/*
+ * The on-chip temperature of the DS3231 (0.1 degC)
+ *
+ * The DS3231 does a conversion every 64 seconds by itself.
+ */
+class DS3231TempSensor
+{
+public:
+  void start();
+  bool poll() { return true; }
+  bool isValid() const { return true; }
+  int16_t getValue(uint8_t) { return _value; }
+private:
+  int16_t       _value;
+};
+#endif
+
+extern SHT21Sensor      sht21Sensor;
+extern BMP085Sensor     bmp085Sensor;
+extern BatterySensor    batterySensor;
+#if ENABLE_RTC_TEMP
+extern DS3231TempSensor rtcTempSensor;
+#endif
+
+#endif /* SENSORS_H_ */
@@ -0,0 +1,57 @@
+#include <Arduino.h>
+#include <Sodaq_DS3231.h>
+
+#include "SoftClock.h"
+
+static bool clockValid;
+static uint32_t baseTs;                 // The epoch time at baseMillis
+static uint32_t baseMillis;
+static uint32_t lastRTCRead;            // The epoch time of the last read of the RTC
+
+/*
+ * Set the clock from the RTC
+ *
+ * The RTC only gives whole seconds, so the clock can be up to a second
+ * behind until the next alarm.
+ */
+static void readClockFromRTC()
+{
+  setClockNow(rtc.now().getEpoch());
+  lastRTCRead = baseTs;
+}
+
+/*
+ * Return the current epoch time
+ */
+uint32_t getClockNow()
+{
+  if (clockValid) {
+    uint32_t now = baseTs + (millis() - baseMillis) / 1000;
+    if (now - lastRTCRead < CLOCK_RESYNC_INTERVAL) {
+      return now;
+    }
+  }
+  readClockFromRTC();
+  return baseTs;
+}
+
+/*
+ * Set the clock, the time is exact at this moment
+ */
+void setClockNow(uint32_t ts)
+{
+  baseTs = ts;
+  baseMillis = millis();
+  clockValid = true;
+}
+
+/*
+ * Forget the time, the next getClockNow() reads the RTC
+ *
+ * This is needed after a sleep (millis() does not run) and after the RTC
+ * was set.
+ */
+void invalidateClock()
+{
+  clockValid = false;
+}
@@ -0,0 +1,21 @@
+#ifndef SOFTCLOCK_H_
+#define SOFTCLOCK_H_
+
+#include <stdint.h>
+
+/*
+ * A software clock with the epoch time of the RTC
+ *
+ * While the MCU is awake the clock runs on millis(). When the MCU was
+ * woken up by the RTC alarm, the wake source sets the clock to the time
+ * of the alarm. After any other wake up the clock is invalid. The DS3231
+ * is only read when the clock is invalid, or when the last read was
+ * CLOCK_RESYNC_INTERVAL seconds ago.
+ */
+#define CLOCK_RESYNC_INTERVAL   (15 * 60)
+
+uint32_t getClockNow();
+void setClockNow(uint32_t ts);
+void invalidateClock();
+
+#endif /* SOFTCLOCK_H_ */
@@ -0,0 +1,128 @@
+#include <Arduino.h>
+#include <avr/wdt.h>
+#include <Sodaq_DS3231.h>
+#include <Sodaq_PcInt.h>
+
+#include "WakeSource.h"
+#include "MyWatchdog.h"
+#include "SoftClock.h"
+#include "pindefs.h"
+
+// The number of seconds we can sleep before we must look at the RTC again
+static uint32_t secondsToSleep;
+// The period of the watchdog, in seconds
+static uint8_t watchdogSeconds;
+
+#ifdef RTC_INT_PIN
+static volatile bool alarm_flag;
+// The epoch time of the programmed alarm
+static uint32_t alarmTs;
+
+static void rtcAlarmISR()
+{
+  // The /INT pin of the DS3231 is active low
+  if (digitalRead(RTC_INT_PIN) == LOW) {
+    alarm_flag = true;
+  }
+}
+#endif
+
+void setupWakeSource()
+{
+#ifdef RTC_INT_PIN
+  pinMode(RTC_INT_PIN, INPUT_PULLUP);
+  rtc.clearINTStatus();
+  PcInt::attachInterrupt(RTC_INT_PIN, rtcAlarmISR);
+#endif
+  secondsToSleep = 0;
+  watchdogSeconds = 1;
+  setupWatchdog();
+}
+
+/*
+ * Prepare the next wake up, secs seconds from now
+ */
+void setWakeup(uint32_t now, uint32_t secs)
+{
+#ifdef RTC_INT_PIN
+  // The alarm must not be too close, the RTC may already be in the
+  // next second while we program it.
+  if (secs >= 2) {
+    alarmTs = now + secs;
+    DateTime dt(rtc.makeDateTime(alarmTs));
+    rtc.clearINTStatus();
+    rtc.enableInterrupts(dt.hour(), dt.minute(), dt.second());
+    if ((int32_t)(alarmTs - rtc.now().getEpoch()) > 0) {
+      // Only the alarm wakes us, see WakeSource.h
+      secondsToSleep = 0;
+      wdt_disable();
+      return;
+    }
+    // Too late, the RTC is already at the alarm time
+    secs = 1;
+  }
+  // An old alarm does not tell the time
+  alarmTs = 0;
+#endif
+  // The watchdog oscillator is not very accurate (about 10%), so we only
+  // sleep a part of the time until the next event. Then we look at the
+  // RTC again, which brings us closer to the event each time.
+  secondsToSleep = secs - secs / 8;
+  watchdogSeconds = setWatchdogSeconds(secondsToSleep);
+}
+
+/*
+ * Handle a wake up of the MCU
+ *
+ * The return value is true if it is time to look at the RTC and run the
+ * events that are due.
+ *
+ * The software clock did not run during the sleep. After the RTC alarm
+ * the time is known, after the watchdog the RTC must be read again.
+ */
+bool checkWakeup()
+{
+  bool due = false;
+  if (hz_flag) {
+    wdt_reset();
+    WDTCSR |= _BV(WDIE);
+    hz_flag = false;
+    invalidateClock();
+
+    if (secondsToSleep > watchdogSeconds) {
+      // No need to look at the RTC yet, nothing is due
+      secondsToSleep -= watchdogSeconds;
+    } else {
+      secondsToSleep = 0;
+      due = true;
+    }
+  }
+#ifdef RTC_INT_PIN
+  if (alarm_flag) {
+    alarm_flag = false;
+    // The watchdog was off during the sleep
+    watchdogSeconds = setWatchdogSeconds(8);
+    rtc.clearINTStatus();
+    if (alarmTs != 0) {
+      setClockNow(alarmTs);
+    }
+    due = true;
+  }
+#endif
+  return due;
+}
+
+/*
+ * Is there a wake up that wasn't handled yet?
+ *
+ * This must be called with interrupts disabled, right before going to sleep.
+ */
+bool isWakeupPending()
+{
+#ifdef RTC_INT_PIN
+  if (alarm_flag) {
+    return true;
+  }
+#endif
+  return hz_flag;
+}
@@ -0,0 +1,25 @@
+#ifndef WAKESOURCE_H_
+#define WAKESOURCE_H_
+
+#include <stdint.h>
+
+/*
+ * The wake source decides when the MCU must wake up to look at the RTC.
+ *
+ * If the RTC INT pin is connected (RTC_INT_PIN in pindefs.h) the DS3231
+ * alarm is programmed for the next wake up, and the watchdog is switched
+ * off during the sleep. It can't count longer than 8 seconds, so it would
+ * only wake up the MCU for nothing. The alarm wake up switches it on again.
+ * If the alarm time has already passed when it is programmed, it would
+ * not go off until the next day. Then the watchdog is used anyway.
+ *
+ * Without the RTC alarm the watchdog counts down the seconds. The MCU
+ * wakes up every 8 seconds or more often, restarts the watchdog clock,
+ * sets WDIE again and goes back to sleep.
+ */
+void setupWakeSource();
+void setWakeup(uint32_t now, uint32_t secs);
+bool checkWakeup();
+bool isWakeupPending();
+
+#endif /* WAKESOURCE_H_ */
@@ -49,6 +49,9 @@
 #define BEEPORT         Serial1
 #define BEEPORT_BEGIN(baud)     BEEPORT.begin(baud)
 
+// The /INT pin of the DS3231, used to wake up at the RTC alarm
+#define RTC_INT_PIN     A7      // PA7
+
 #endif
 
 #define FATAL_LED       GROVEPWR
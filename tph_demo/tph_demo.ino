@@ -20,14 +20,21 @@
 
 //################ defines ################
 
-#define ADC_AREF        3.3     // DEFAULT see wiring_analog.c
-#define ADC_AREF_MV     3300    // In milliVolt
-#define MIN_BATTERY_LEVEL1_GPRSBEE      3.5    // Below this level do not use GPRSbee
-#define MIN_BATTERY_LEVEL2_GPRSBEE      3.9    // Below this level try GPRSbee on and check
+#define ADC_AREF_MV     3300    // In milliVolt, DEFAULT see wiring_analog.c
+#define MIN_BATTERY_LEVEL1_GPRSBEE      3500    // mV, below this level do not use GPRSbee
+#define MIN_BATTERY_LEVEL2_GPRSBEE      3900    // mV, below this level try GPRSbee on and check
+
+// Make it 1 to record the traffic with the GPRSbee during uploads
+#define ENABLE_GPRSBEE_TRACE    0
 
 //############ time service ################
 #define TIMEURL "http://time.sodaq.net/?"
 
+//############ upload ################
+// <station name> '.' <device ID> '.' <timestamp> ".csv"
+// See Config.h for STATION_NAME_SIZE
+#define UPLOAD_FILENAME_SIZE    ((STATION_NAME_SIZE - 1) + 1 + 8 + 1 + 10 + 4 + 1)
+
 //################ includes ################
 #include <avr/sleep.h>
 #include <avr/wdt.h>
@@ -44,18 +51,28 @@
 #include <Sodaq_SoftSerial.h>
 #include <RTCTimer.h>
 #include <Sodaq_PcInt.h>
+#include <Sodaq_TraceStream.h>
+#include <Sodaq_TextBuf.h>
 
 #include "SQ_Diag.h"
 #include "SQ_Utils.h"
 #include "SQ_StartupCommands.h"
 #include "SQ_UploadPages.h"
 #include "SQ_DataflashUtils.h"
+#include "SQ_TimeSync.h"
 
 // Our own libraries
 #include "version.h"
 #include "pindefs.h"
 #include "MyWatchdog.h"
+#include "WakeSource.h"
 #include "DataRecord.h"
+#include "SampleStats.h"
+#include "Sensors.h"
+#include "DeviceIdentity.h"
+#include "RamUsage.h"
+#include "SoftClock.h"
+#include "ClockDrift.h"
 #include "Config.h"
 
 //################ variables ################
@@ -63,32 +80,75 @@
 Sodaq_BMP085 bmp;
 
 RTCTimer timer;
+// The events that change when the long term starts
+RTCEventHandle recordEvent;
+RTCEventHandle sampleEvent;
+RTCEventHandle uploadEvent;
+RTCEventHandle flashLedEvent;
+
+// The samples for the next record
+SampleStats sampleStats[NR_CHANNELS];
+uint8_t samplesPerRecord;
+uint8_t samplesTaken;
+uint16_t samplePeriod;
+
+// The last stored record, to see if a new record differs enough
+DataRecord_t lastRecord;
+bool haveLastRecord;
+uint16_t nrRepeats;
+
+#if ENABLE_GPRSBEE_TRACE
+static uint8_t beeTraceBuffer[1024];
+TraceStream beeTrace(BEEPORT, beeTraceBuffer, sizeof(beeTraceBuffer));
+#define BEESTREAM       beeTrace
+#else
+#define BEESTREAM       BEEPORT
+#endif
 
 bool doneRetryUpload;
 
+// The interval of the current upload schedule (short term or long term)
+uint16_t uploadInterval;
+
 uint8_t oldMCUSR;
 
+// The last time the RTC was synchronized
+uint32_t lastTimeSync;
+
 //######### forward declare #############
 
 void systemSleep();
+void idleSleep();
 
+void startSampling(uint16_t interval);
+void startSampleEvent();
+void takeSample(uint32_t now);
+void closeRecord(uint32_t now);
+void clearSamples();
 void createRecord(uint32_t now);
+bool isRecordChanged(const DataRecord_t & rec);
+void readSensors();
 void doUploadData(uint32_t now);
 void doSystemCheck(uint32_t now);
 void showDateTime(uint32_t now);
+void showTimerStats();
 void startLongTerm(uint32_t now);
 void flashLed(uint32_t now);
 void doCheckGPRSoff(uint32_t now);
+void scheduleCheckGPRSoff(uint32_t now);
+bool keepModemAsleep();
 
 uint32_t getNow();
+void setNextWakeup(uint32_t now);
 void syncRTCwithServer(uint32_t now);
+void syncRTCwithNetwork();
+void uploadConnected();
+bool syncRTC(TimeSyncProvider provider);
+bool getServerTime(TimeSyncResult_t *res);
 
-float getRealBatteryVoltage();
 uint16_t getBatteryMilliVolt();
 bool checkBatteryOnGPRSbee();
 
-void addDeviceId(String & str);
-
 void showStartupBanner(Stream & stream, uint8_t mcusr);
 void showDeviceId(Stream & stream);
 bool checkConfig();
@@ -140,10 +200,11 @@ void setup(void)
 
   Serial.begin(9600);
   BEEPORT_BEGIN(9600);
-  gprsbee.init(BEEPORT, BEECTS, BEEDTR);
+  gprsbee.init(BEESTREAM, BEECTS, BEEDTR);
 #if SODAQ_VARIANT == SODAQ_VARIANT_MBILI
   gprsbee.setPowerSwitchedOnOff(true);          // Use the D23 switched power available on Mbili
 #endif
+  gprsbee.setLTSMode(true);                     // Get the network time, see syncRTCwithNetwork
 
 #if ENABLE_DIAG
   diagport.begin(9600);
@@ -168,7 +229,12 @@ void setup(void)
 
   // Initialize the Data Flash chip. Only then we can display the
   // device ID.
-  dflash.init(MISO, MOSI, SCK, SS);
+  if (!dflash.init(MISO, MOSI, SCK, SS)) {
+    DIAGPRINTLN(F("Unknown dataflash"));
+  }
+  DIAGPRINT(F("dataflash ")); DIAGPRINT(dflash.getNrPages());
+  DIAGPRINT(F(" pages of ")); DIAGPRINTLN(dflash.getPageSize());
+  initDeviceIdentity();
   showDeviceId(Serial);
 #if ENABLE_DIAG
   if (static_cast<Stream*>(&Serial) != static_cast<Stream*>(&diagport)) {
@@ -196,27 +262,31 @@ void setup(void)
   // parms C - after how long starts the "long term"
   // parms D - syncRTC interval
   uint16_t untilLongTerm = parms.getL();
-  timer.every(parms.getAs(), createRecord, untilLongTerm / parms.getAs());
-  timer.every(parms.getUs(), doUploadData, untilLongTerm / parms.getUs());
+  startSampling(parms.getAs());
+  uploadEvent = timer.every(parms.getUs(), doUploadData);
+  uploadInterval = parms.getUs();
 
   // Execute a function that will switch intervals for sampling
   // and uploading.
   // After the short term, create a new event to sample at 5 minute intervals
-  timer.every(untilLongTerm + 1, startLongTerm, 1);
+  ts = getNow();
+  timer.at(ts + untilLongTerm + 1, startLongTerm);
 
   if (parms.getS() > 10 * 60) {
     // Do an early RTC sync, so that we don't have to wait 24 hours
-    timer.every(2L * 60, syncRTCwithServer, 1);
+    timer.at(ts + 2L * 60, syncRTCwithServer);
   }
   timer.every(parms.getS(), syncRTCwithServer);
 
   // Flash a LED to has a visual indication that the system is still alive
-  timer.every(3, flashLed);
+  // Only during the short term, otherwise we can never sleep longer than
+  // a few seconds.
+  flashLedEvent = timer.every(3, flashLed);
 
   // Do an extra check if GPRS is switched off after 5 seconds.
-  timer.every(5, doCheckGPRSoff, 2);
+  scheduleCheckGPRSoff(ts);
 
-  setupWatchdog();
+  setupWakeSource();
 
   interrupts();
 
@@ -226,13 +296,9 @@ void setup(void)
 //################ loop ################
 void loop(void)
 {
-  if (hz_flag) {
-    wdt_reset();
-    WDTCSR |= _BV(WDIE);
-
-    hz_flag = false;
-
+  if (checkWakeup()) {
     timer.update();
+    setNextWakeup(getNow());
   }
 
   diagport.flush();
@@ -247,41 +313,147 @@ void loop(void)
  */
 uint32_t getNow()
 {
-  return rtc.now().getEpoch();
+  return getClockNow();
 }
 
 void startLongTerm(uint32_t now)
 {
   //DIAGPRINTLN(F("startLongTerm"));
-  // The previous schedule of creating records and doing uploads has stopped.
+  // Stop the schedule of the short term
+  timer.cancel(uploadEvent);
+  timer.cancel(flashLedEvent);
 
   // Start a new sequences with much longer interval.
-  timer.every(parms.getAl(), createRecord);
-  timer.every(parms.getUl(), doUploadData);
+  startSampling(parms.getAl());
+  uploadEvent = timer.every(parms.getUl(), doUploadData);
+  uploadInterval = parms.getUl();
+
+  if (gprsbee.isSleeping() && !keepModemAsleep()) {
+    // The uploads are too far apart now, switch it off
+    doCheckGPRSoff(now);
+  }
+}
+
+/*
+ * Start sampling, with a new record every interval seconds
+ *
+ * A record is made of a number of samples (parameter sn), spread over the
+ * interval. At most one sample per second. The samples are interval / nr
+ * seconds apart, the remainder goes to the gap before the last sample.
+ * The last sample is taken by the record event, so that the records are
+ * exactly interval seconds apart.
+ */
+void startSampling(uint16_t interval)
+{
+  timer.cancel(recordEvent);
+  timer.cancel(sampleEvent);
+
+  uint16_t nr = parms.getSn();
+  if (nr > interval) {
+    nr = interval;
+  }
+  if (nr > 255) {
+    nr = 255;
+  }
+  if (nr == 0) {
+    nr = 1;
+  }
+  samplesPerRecord = nr;
+  samplePeriod = interval / nr;
+  clearSamples();
+  recordEvent = timer.every(interval, closeRecord);
+  startSampleEvent();
+}
+
+/*
+ * Schedule the samples of a record, except the last one
+ */
+void startSampleEvent()
+{
+  if (samplesPerRecord > 1) {
+    sampleEvent = timer.every(samplePeriod, takeSample, samplesPerRecord - 1);
+  }
+}
+
+/*
+ * Read the sensors and add the values to the statistics
+ *
+ * A sensor that did not deliver a value is skipped, it doesn't add a
+ * made up value.
+ */
+void takeSample(uint32_t now)
+{
+  readSensors();
+#define DATA_CHANNEL_SAMPLE(name, type, sensor, index, deadband) \
+  if (sensor.isValid()) { \
+    sampleStats[CHANNEL_##name].add(sensor.getValue(index)); \
+  }
+  DATA_CHANNELS(DATA_CHANNEL_SAMPLE)
+  if (samplesTaken < 0xFF) {
+    ++samplesTaken;
+  }
+}
+
+/*
+ * Take the last sample, create the record and start the next one
+ */
+void closeRecord(uint32_t now)
+{
+  // A late record event could come before the last of the samples
+  timer.cancel(sampleEvent);
+  takeSample(now);
+  createRecord(now);
+  startSampleEvent();
+}
+
+void clearSamples()
+{
+  for (uint8_t i = 0; i < NR_CHANNELS; ++i) {
+    sampleStats[i].clear();
+  }
+  samplesTaken = 0;
 }
 
 /*
  * Create a record and write it to dataflash
  *
- * This function reads all sensors and counters and battery voltage
+ * The values are the mean of the samples. A channel without a single
+ * valid sample gets DATA_NO_VALUE.
  */
 void createRecord(uint32_t now)
 {
   DataRecord_t rec;
 
-  /*
-   * The battery is connected to the middle of a 10M and 2M resistor
-   * that are between Vcc and GND.
-   * So actual battery voltage is:
-   *    <adc value> * 1023. / AREF * (10+2) / 2
-   */
-
   rec.ts = now;
-  rec.temp_sht21 = SHT2x.GetTemperature() * 10;
-  rec.hum_sht21 = SHT2x.GetHumidity() * 10;
-  rec.temp_bmp85 = bmp.readTemperature() * 10;
-  rec.pres_bmp85 = bmp.readPressure() / 10;         // divide by 100 and multiply by 10
-  rec.batteryVoltage = getBatteryMilliVolt();
+#define DATA_CHANNEL_MEAN(name, type, sensor, index, deadband) \
+  rec.name = sampleStats[CHANNEL_##name].getCount() != 0 ? \
+      (type)sampleStats[CHANNEL_##name].getMean() : (type)DATA_NO_VALUE;
+  DATA_CHANNELS(DATA_CHANNEL_MEAN)
+#if ENABLE_RECORD_STATS
+  rec.nrSamples = samplesTaken;
+  for (uint8_t i = 0; i < NR_CHANNELS; ++i) {
+    if (sampleStats[i].getCount() == 0) {
+      rec.stats[i].min = DATA_NO_VALUE;
+      rec.stats[i].max = DATA_NO_VALUE;
+      rec.stats[i].stddev = DATA_NO_VALUE;
+      continue;
+    }
+    rec.stats[i].min = sampleStats[i].getMin();
+    rec.stats[i].max = sampleStats[i].getMax();
+    rec.stats[i].stddev = sampleStats[i].getStdDev();
+  }
+#endif
+  clearSamples();
+
+  if (!isRecordChanged(rec)) {
+    // Not stored, but counted in the next record that is stored
+    ++nrRepeats;
+    return;
+  }
+  rec.repeats = nrRepeats;
+  nrRepeats = 0;
+  lastRecord = rec;
+  haveLastRecord = true;
 
   {
     static int counter;
@@ -297,24 +469,79 @@ void createRecord(uint32_t now)
   addCurPageRecord(&rec, now);
 }
 
+/*
+ * Is the record different enough from the last stored record?
+ *
+ * With a max silence (parameter dm) a record is only stored if one of
+ * the channels moved beyond its deadband, or if the last stored record
+ * is dm seconds old or more. Otherwise every record is stored.
+ */
+bool isRecordChanged(const DataRecord_t & rec)
+{
+  if (parms.getDm() == 0 || !haveLastRecord) {
+    return true;
+  }
+  if (rec.ts - lastRecord.ts >= parms.getDm() || nrRepeats == 0xFFFF) {
+    return true;
+  }
+  // A channel that gets or loses its value is far beyond any deadband
+#define DATA_CHANNEL_CHANGED(name, type, sensor, index, deadband) \
+  if (labs((int32_t)rec.name - lastRecord.name) > (deadband)) { \
+    return true; \
+  }
+  DATA_CHANNELS(DATA_CHANNEL_CHANGED)
+  return false;
+}
+
+/*
+ * Read all the sensors of the record
+ *
+ * The conversions of all sensors are started at the same time and the
+ * results are collected when they are ready. In the mean time the MCU is
+ * in idle sleep. Afterwards the values are available from the sensor
+ * drivers. A driver that did not finish in time has no valid values.
+ */
+void readSensors()
+{
+#define DATA_CHANNEL_START(name, type, sensor, index, deadband) \
+  if (index == 0) { \
+    sensor.start(); \
+  }
+  DATA_CHANNELS(DATA_CHANNEL_START)
+
+  uint32_t start = millis();
+  while (true) {
+    bool ready = true;
+#define DATA_CHANNEL_POLL(name, type, sensor, index, deadband) \
+    if (index == 0 && !sensor.poll()) { \
+      ready = false; \
+    }
+    DATA_CHANNELS(DATA_CHANNEL_POLL)
+    if (ready) {
+      break;
+    }
+    if (millis() - start > 300) {
+      // Don't hang here if a sensor doesn't respond
+      break;
+    }
+    idleSleep();
+  }
+}
+
 /*
  * Make the FTP file name
  *
  * The file name has the following syntax:
  *   <station name> '.' <timestamp> ".csv"
  */
-void makeUploadFilename(String & filename, uint32_t start)
-{
-  if (filename.reserve(40)) {
-    filename += parms.getStationName();
-    filename += '.';
-    addDeviceId(filename);
-    filename += '.';
-    filename += start;
-    filename += ".csv";
-  } else {
-    // Not enough space
-  }
+void makeUploadFilename(TextBuf & filename, uint32_t start)
+{
+  filename.add(parms.getStationName());
+  filename.add('.');
+  addDeviceId(filename);
+  filename.add('.');
+  filename.add(start);
+  filename.add(F(".csv"));
 }
 
 /*
@@ -323,15 +550,16 @@ void makeUploadFilename(String & filename, uint32_t start)
 void doUploadData(uint32_t now)
 {
   // Prepare the filename prefix
-  String filename;
+  TextBufN<UPLOAD_FILENAME_SIZE> filename;
   uint32_t start;
   bool status;
 
   start = getNow();
   makeUploadFilename(filename, start);
   showFreeRAM();
-  if (filename.length() == 0) {
-    // Fatal error
+  if (filename.isTruncated()) {
+    // Can't happen, the buffer fits the longest station name
+    DIAGPRINT(F("Upload filename too long: ")); DIAGPRINTLN(filename.c_str());
     return;
   }
 
@@ -340,20 +568,37 @@ void doUploadData(uint32_t now)
   // If we do it can be send to the server in a moment.
   newCurPage(start);
 
-  status = uploadPages(filename.c_str(), parms);
+  gprsbee.setSleepMode(keepModemAsleep());
+#if ENABLE_GPRSBEE_TRACE
+  beeTrace.clear();
+#endif
+  beginRamSection();
+  status = uploadPages(filename.c_str(), parms, uploadConnected);
+  endRamSection(RAM_SECTION_UPLOAD);
   DIAGPRINT(F("time upload: ")); DIAGPRINTLN((int)(getNow() - start));
+  showTimerStats();
+  showRamUsage();
+#if ENABLE_GPRSBEE_TRACE && ENABLE_DIAG
+  beeTrace.showStats(diagport);
+  beeTrace.dump(diagport);
+#endif
   if (!status) {
     if (!doneRetryUpload) {
       // Repeat again in a few minutes, but only once.
-      timer.every(120, doUploadData, 1);
+      timer.at(getNow() + 120, doUploadData);
       doneRetryUpload = true;
     }
   } else {
     doneRetryUpload = false;
   }
 
-  // Do an extra check if GPRS is switched off after 5 seconds.
-  timer.every(5, doCheckGPRSoff, 2);
+  // After a failure the SIM900 stays asleep too (if keepModemAsleep()),
+  // then the retry does not need a boot and a GPRS attach. If it stopped
+  // answering the GPRSbee has already switched it off.
+  if (!gprsbee.isSleeping()) {
+    // Do an extra check if GPRS is switched off after 5 seconds.
+    scheduleCheckGPRSoff(getNow());
+  }
 }
 
 /*
@@ -366,6 +611,8 @@ void doSystemCheck(uint32_t now)
   showDateTime(now);
 
   showBattVolt(getBatteryMilliVolt());
+  showTimerStats();
+  showRamUsage();
   parms.dump();
   //showFreeRAM();
   //memoryDump();
@@ -376,16 +623,39 @@ void doSystemCheck(uint32_t now)
  */
 void showDateTime(uint32_t now)
 {
-  String strDt;
-  strDt.reserve(30);
+  TextBufN<20> strDt;
   DateTime dt(rtc.makeDateTime(now));
   dt.addToString(strDt);
-  DIAGPRINTLN(strDt);
+  DIAGPRINTLN(strDt.c_str());
+}
+
+/*
+ * Show the statistics of the timer events
+ *
+ * For each active event: the period, how many times it was late, the
+ * maximum lateness in seconds, and how many periods were skipped.
+ */
+void showTimerStats()
+{
+#if ENABLE_DIAG
+  for (uint8_t i = 0; i < MAX_NUMBER_OF_RTCEVENTS; ++i) {
+    const RTCEvent & ev = timer.getEvent(i);
+    if (!ev.isActive()) {
+      continue;
+    }
+    DIAGPRINT(F("event ")); DIAGPRINT(i);
+    DIAGPRINT(F(" period=")); DIAGPRINT(ev.getPeriod());
+    DIAGPRINT(F(" late=")); DIAGPRINT(ev.getNrLate());
+    DIAGPRINT(F(" maxlate=")); DIAGPRINT(ev.getMaxLate());
+    DIAGPRINT(F(" skipped=")); DIAGPRINTLN(ev.getNrSkipped());
+  }
+#endif
 }
 
 //######### watchdog and system sleep #############
 void systemSleep()
 {
+  dflash.powerDownIfIdle();
   ADCSRA &= ~_BV(ADEN);         // ADC disabled
 
   /*
@@ -403,8 +673,8 @@ void systemSleep()
    * This code is from the documentation in avr/sleep.h
    */
   cli();
-  // Only go to sleep if there was no watchdog interrupt.
-  if (!hz_flag)
+  // Only go to sleep if there was no wake up interrupt.
+  if (!isWakeupPending())
   {
     sleep_enable();
     sei();
@@ -416,68 +686,150 @@ void systemSleep()
   ADCSRA |= _BV(ADEN);          // ADC enabled
 }
 
+/*
+ * Program the wake up for the next event
+ */
+void setNextWakeup(uint32_t now)
+{
+  uint32_t secs = timer.getSecondsUntilNextEvent(now);
+  if (secs > 60L * 60) {
+    // Look at the RTC at least once every hour
+    secs = 60L * 60;
+  }
+  setWakeup(now, secs);
+}
+
+/*
+ * Sleep until the next interrupt, but keep the timers running
+ *
+ * This is used for short waits. The millis() interrupt wakes us up
+ * again within a millisecond.
+ */
+void idleSleep()
+{
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  sleep_mode();
+}
+
 //################ RTC ################
 /*
  * Synchronize RTC with a time server
+ *
+ * This is the fallback if the RTC was not synchronized with the network
+ * time during one of the uploads.
  */
 void syncRTCwithServer(uint32_t now)
 {
   //DIAGPRINT(F("syncRTCwithServer ")); DIAGPRINTLN(now);
 
-  String url;
-  url.reserve(22 + 1 + 8);      // http://time.sodaq.net/?efee734f
-  addPstrToString(url, PSTR(TIMEURL));
-  addDeviceId(url);
-  if (oldMCUSR) {
-    // Only send MCUSR the first time.
-    url += '&';
-    url += oldMCUSR;
-    oldMCUSR = 0;
-  }
-  char buffer[20];
-  if (gprsbee.doHTTPGET(parms.getAPN(), url, buffer, sizeof(buffer))) {
-    //DIAGPRINT(F("HTTP GET: ")); DIAGPRINTLN(buffer);
-    uint32_t newTs;
-    if (getUValue(buffer, &newTs)) {
-      // Tweak the timestamp a little because doHTTPGET took a few seconds
-      // to close the connection after getting the time from the server
-      newTs += 3;
-      uint32_t oldTs = getNow();
-      int32_t diffTs = labs(newTs - oldTs);
-      if (diffTs > 30) {
-        DIAGPRINT(F("Updating RTC, old=")); DIAGPRINT(oldTs);
-        DIAGPRINT(F(" new=")); DIAGPRINTLN(newTs);
-        timer.adjust(oldTs, newTs);
-        rtc.setEpoch(newTs);
-      }
-    }
+  if (lastTimeSync != 0 && (now - lastTimeSync) < getTimeSyncInterval(parms.getS()) && !oldMCUSR) {
+    // Recently done with the network time, or the RTC is stable enough
+    return;
   }
+
+  beginRamSection();
+  syncRTC(getServerTime);
+  endRamSection(RAM_SECTION_TIMESYNC);
   //doSystemCheck();
   //DIAGPRINTLN(F("syncRTCwithServer - end"));
 
-  // Do an extra check if GPRS is switched off after 5 seconds.
-  timer.every(5, doCheckGPRSoff, 2);
+  if (!gprsbee.isSleeping()) {
+    // Do an extra check if GPRS is switched off after 5 seconds.
+    scheduleCheckGPRSoff(getNow());
+  }
 }
 
 /*
- * \brief Read the battery voltage and compute actual voltage
+ * Synchronize RTC with the network time
+ *
+ * This is called by uploadPages while the GPRSbee is connected, so
+ * it costs no extra modem session.
  */
-float getRealBatteryVoltage()
+void syncRTCwithNetwork()
 {
-  /*
-   * This pin is connected to the middle of a 4M7 and 10M resistor
-   * that are between Vcc (battery) and GND.
-   * So actual battery voltage is:
-   *    <adc value> * 1023. / AREF * (47+100) / 100
-   */
-  uint16_t batteryVoltage = analogRead(BATVOLTPIN);
-  return (ADC_AREF / 1023.) * (BATVOLT_R1 + BATVOLT_R2) / BATVOLT_R2 * batteryVoltage;
+  syncRTC(getNetworkTime);
+}
+
+/*
+ * The modem is connected during the upload
+ */
+void uploadConnected()
+{
+  syncRTCwithNetwork();
+  readModemIdentity();
+}
+
+/*
+ * Synchronize RTC with the time of a time sync provider
+ *
+ * The measured offset and round trip time are shown, so that we can see
+ * how accurate the RTC is. The offsets are also used to estimate the
+ * drift of the RTC, see ClockDrift.h.
+ */
+bool syncRTC(TimeSyncProvider provider)
+{
+  TimeSyncResult_t res;
+  if (!(*provider)(&res)) {
+    return false;
+  }
+
+  uint32_t newTs = getTimeSyncNow(res);
+  // The drift is that of the RTC, not of the software clock
+  uint32_t oldTs = rtc.now().getEpoch();
+  int32_t offset = newTs - oldTs;
+  DIAGPRINT(F("Time sync offset=")); DIAGPRINT(offset);
+  DIAGPRINT(F(" rtt=")); DIAGPRINTLN(res.rtt);
+  updateClockDrift(newTs, offset, res.rtt);
+  if (labs(offset) > 30) {
+    DIAGPRINT(F("Updating RTC, old=")); DIAGPRINT(oldTs);
+    DIAGPRINT(F(" new=")); DIAGPRINTLN(newTs);
+    timer.adjust(oldTs, newTs);
+    rtc.setEpoch(newTs);
+    invalidateClock();
+    addClockCorrection(offset);
+  }
+  lastTimeSync = newTs;
+  return true;
+}
+
+/*
+ * Get the time from the time server
+ *
+ * The server produced the timestamp somewhere during the HTTP request.
+ * We assume it was in the middle of it.
+ */
+bool getServerTime(TimeSyncResult_t *res)
+{
+  TextBufN<23 + 8 + 4 + 1> url;  // http://time.sodaq.net/?efee734f&255
+  url.add(F(TIMEURL));
+  addDeviceId(url);
+  if (oldMCUSR) {
+    // Only send MCUSR the first time.
+    url.add('&');
+    url.add(oldMCUSR);
+    oldMCUSR = 0;
+  }
+  char buffer[20];
+  if (!gprsbee.doHTTPGET(parms.getAPN(), url.c_str(), buffer, sizeof(buffer))) {
+    return false;
+  }
+  //DIAGPRINT(F("HTTP GET: ")); DIAGPRINTLN(buffer);
+  if (!getUValue(buffer, &res->ts)) {
+    return false;
+  }
+  res->rtt = gprsbee.getHTTPACTIONTime();
+  res->ms = gprsbee.getHTTPACTIONEnd() - res->rtt / 2;
+  return true;
 }
 
 /*
  * \brief Read the battery voltage and compute actual voltage in milliVolt
  *
- * See getRealBatteryVoltage for more details
+ * This pin is connected to the middle of a 4M7 and 10M resistor
+ * that are between Vcc (battery) and GND.
+ * So actual battery voltage is:
+ *    <adc value> * AREF / 1023 * (47+100) / 100
+ * This is all done in integer arithmetic, there is no FPU.
  */
 uint16_t getBatteryMilliVolt()
 {
@@ -502,11 +854,40 @@ void doCheckGPRSoff(uint32_t now)
   }
 }
 
+/*
+ * Schedule a check if the GPRSbee is really off, 5 seconds from now
+ *
+ * This is a one-shot event, so if it is already pending nothing is added.
+ */
+void scheduleCheckGPRSoff(uint32_t now)
+{
+  timer.at(now + 5, doCheckGPRSoff);
+}
+
+/*
+ * Decide if the GPRSbee may stay registered (in sleep) until the next upload
+ *
+ * If the next upload is not too far away it costs less energy to keep the
+ * SIM900 in sleep than to do a full boot, network search and GPRS attach
+ * again.
+ */
+bool keepModemAsleep()
+{
+  return parms.getMs() != 0 && uploadInterval <= parms.getMs();
+}
+
 void showDeviceId(Stream & stream)
 {
-  String devId;
+  TextBufN<8 + 1> devId;
   addDeviceId(devId);
-  stream.print(F("device ID ")); stream.println(devId);
+  stream.print(F("device ID ")); stream.println(devId.c_str());
+  const DeviceIdentity_t & id = getDeviceIdentity();
+  if (id.imei[0]) {
+    stream.print(F("IMEI ")); stream.println(id.imei);
+  }
+  if (id.iccid[0]) {
+    stream.print(F("ICCID ")); stream.println(id.iccid);
+  }
 }
 
 /*
@@ -525,27 +906,6 @@ void showStartupBanner(Stream & stream, uint8_t mcusr)
   stream.print(F(" MCUSR=")); stream.println(mcusr, HEX);
 }
 
-/*
- * Add the unique device id, taken from dataflash security register
- */
-void addDeviceId(String &str)
-{
-  uint8_t buffer[128];
-  dflash.readSecurityReg(buffer, 128);
-  /* An example of the second 64 bytes of the security register
-0D0414071A2D1F2600011204FFFFE8FF
-303032533636313216140AFFFFFFFFFF
-3E3E3E3E3E3C3E3E3E3C3E3C3C3E3E3C
-FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF
-   */
-  //dumpBuffer(buffer + 64, 64);
-  uint16_t crc1 = crc16_ccitt(buffer + 64, 16);
-  uint16_t crc2 = crc16_ccitt(buffer + 64 + 16, 16);
-
-  add04x(str, crc1);
-  add04x(str, crc2);
-}
-
 /*
  * Check if all required config parameters are filled in
  */